@@ -0,0 +1,705 @@
+/*
+ * @file
+ * Per-module microbenchmark for AudioPrism analysis modules.
+ *
+ * Each module is driven through pushWindow() + doAnalysis() over a set of
+ * prepared spectra, reporting the time per frame, the frame rate and the
+ * number of heap allocations per frame. The SpectralTools kernels are then
+ * timed over a full window for every kernel set the CPU supports, and the
+ * modules backed by the FeatureCache with each set installed, followed by
+ * the entropy with the C library's log2f() and with fast_log2(), along with
+ * the largest error of each against a double precision reference, and the
+ * RealFFT front end against a complex FFT of the same samples. The window size is fixed at compile
+ * time (WINDOW_SIZE), so one executable is built per window size.
+ *
+ * Usage: AudioPrismBench_<size> [--csv] [--frames N] [--input FILE]
+ *
+ *   --csv        print results as comma separated values, the max_error column
+ *                is only set for the entropy rows ("-" elsewhere)
+ *   --frames N   number of analyzed frames per module (default: scaled to size)
+ *   --input FILE replay recorded spectra instead of synthetic ones. FILE is a
+ *                raw little-endian float32 file of consecutive windows, each
+ *                WINDOW_SIZE / 2 magnitudes long.
+ */
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <AudioPrism.h>
+
+//============================================================================
+// ALLOCATION COUNTING
+//============================================================================
+
+static unsigned long allocationCount = 0;
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    void* ptr = malloc(size ? size : 1);
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    allocationCount++;
+    void* ptr = malloc(size ? size : 1);
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+
+//============================================================================
+// INPUT SPECTRA
+//============================================================================
+
+const int NUM_BINS       = WINDOW_SIZE >> 1;
+const int NUM_SYNTHETIC  = 64;
+
+// fill 'spectra' with frames of a decaying harmonic series over a noise floor,
+// drifting in pitch, with a broadband burst every 8th frame
+static void makeSyntheticSpectra(std::vector<float>& spectra)
+{
+    spectra.assign(NUM_SYNTHETIC * NUM_BINS, 0.0);
+    srand(1);
+
+    for (int f = 0; f < NUM_SYNTHETIC; f++) {
+        float* window = spectra.data() + f * NUM_BINS;
+        bool   burst  = (f % 8) == 0;
+
+        for (int i = 0; i < NUM_BINS; i++) {
+            window[i] = float(rand() % (burst ? 4000 : 50));
+        }
+
+        int fundamental = 3 + (f % 5);
+        for (int h = 1; fundamental * h < NUM_BINS; h++) {
+            window[fundamental * h] += 20000.0 / h;
+        }
+    }
+}
+
+// read consecutive float32 windows from a raw file
+static bool loadRecordedSpectra(const char* path, std::vector<float>& spectra)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Error: could not open %s\n", path);
+        return false;
+    }
+
+    std::vector<float> window(NUM_BINS);
+    spectra.clear();
+    while (fread(window.data(), sizeof(float), NUM_BINS, file) == (size_t)NUM_BINS) {
+        spectra.insert(spectra.end(), window.begin(), window.end());
+    }
+    fclose(file);
+
+    if (spectra.empty()) {
+        fprintf(stderr, "Error: %s holds no complete %d-bin windows\n", path, NUM_BINS);
+        return false;
+    }
+    return true;
+}
+
+//============================================================================
+// BENCHMARK DRIVER
+//============================================================================
+
+struct BenchResult {
+    double nsPerFrame;
+    double framesPerSec;
+    double allocsPerFrame;
+};
+
+// time 'numFrames' iterations of pushWindow() followed by doAnalysis()
+// if 'module' is NULL, only the pushWindow() cost is measured
+// with 'prefixSums', the cost of indexing each pushed window is included
+static BenchResult runBench(AnalysisModule* module, const std::vector<float>& spectra,
+    int numFrames, bool prefixSums = false)
+{
+    Spectrogram spectrogram = Spectrogram(2);
+    if (prefixSums) {
+        spectrogram.enablePrefixSums();
+    }
+    spectrogram.clearBuffer();
+    if (module != NULL) {
+        module->setSpectrogram(&spectrogram);
+    }
+
+    int numSpectra = spectra.size() / NUM_BINS;
+
+    // warm up caches and any lazily allocated module state
+    for (int f = 0; f < 16; f++) {
+        spectrogram.pushWindow(spectra.data() + (f % numSpectra) * NUM_BINS);
+        if (module != NULL) {
+            module->doAnalysis();
+        }
+    }
+
+    unsigned long allocsBefore = allocationCount;
+    auto          start        = std::chrono::steady_clock::now();
+
+    for (int f = 0; f < numFrames; f++) {
+        spectrogram.pushWindow(spectra.data() + (f % numSpectra) * NUM_BINS);
+        if (module != NULL) {
+            module->doAnalysis();
+        }
+    }
+
+    auto          end         = std::chrono::steady_clock::now();
+    unsigned long allocsAfter = allocationCount;
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+    BenchResult result;
+    result.nsPerFrame     = ns / numFrames;
+    result.framesPerSec   = 1e9 / result.nsPerFrame;
+    result.allocsPerFrame = double(allocsAfter - allocsBefore) / numFrames;
+    return result;
+}
+
+// time a module of the integer analysis path like runBench(), over a
+// SpectrogramQ15 holding the spectra converted to Q15 with 'fullScale'
+template <class Module>
+static BenchResult runBenchQ15(Module* module, const std::vector<float>& spectra,
+    int numFrames, float fullScale)
+{
+    int numSpectra = spectra.size() / NUM_BINS;
+
+    std::vector<AudioPrism::q15_t> spectraQ15(spectra.size());
+    AudioPrism::q15_from_float_array(spectra.data(), spectraQ15.data(), spectra.size(), fullScale);
+
+    SpectrogramQ15 spectrogram = SpectrogramQ15(2);
+    spectrogram.clearBuffer();
+    module->setSpectrogram(&spectrogram);
+
+    // warm up caches
+    for (int f = 0; f < 16; f++) {
+        spectrogram.pushWindow(spectraQ15.data() + (f % numSpectra) * NUM_BINS);
+        module->doAnalysis();
+    }
+
+    unsigned long allocsBefore = allocationCount;
+    auto          start        = std::chrono::steady_clock::now();
+
+    for (int f = 0; f < numFrames; f++) {
+        spectrogram.pushWindow(spectraQ15.data() + (f % numSpectra) * NUM_BINS);
+        module->doAnalysis();
+    }
+
+    auto          end         = std::chrono::steady_clock::now();
+    unsigned long allocsAfter = allocationCount;
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+    BenchResult result;
+    result.nsPerFrame     = ns / numFrames;
+    result.framesPerSec   = 1e9 / result.nsPerFrame;
+    result.allocsPerFrame = double(allocsAfter - allocsBefore) / numFrames;
+    return result;
+}
+
+// time the SpectralTools kernels of one kernel set over a full window
+static void benchKernels(const AudioPrism::SpectralKernels& kernels,
+    const std::vector<float>& spectra, int numFrames, bool csv)
+{
+    int                numSpectra = spectra.size() / NUM_BINS;
+    std::vector<float> smoothed(NUM_BINS, 0.0);
+    float              sink = 0.0;
+
+    AudioPrism::KernelStats stats;
+    int                     argmax;
+
+    const char* names[] = { "sum", "energy", "flux", "positive_flux", "negative_flux", "smooth", "max", "stats" };
+    for (int k = 0; k < 8; k++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < numFrames; f++) {
+            const float* curr = spectra.data() + (f % numSpectra) * NUM_BINS;
+            const float* prev = spectra.data() + ((f + 1) % numSpectra) * NUM_BINS;
+            switch (k) {
+            case 0: sink += kernels.sum(curr, NUM_BINS); break;
+            case 1: sink += kernels.energy(curr, NUM_BINS); break;
+            case 2: sink += kernels.flux(curr, prev, NUM_BINS); break;
+            case 3: sink += kernels.positive_flux(curr, prev, NUM_BINS); break;
+            case 4: sink += kernels.negative_flux(curr, prev, NUM_BINS); break;
+            case 5: kernels.smooth(curr, smoothed.data(), NUM_BINS, 0.05); break;
+            case 6: sink += kernels.max(curr, NUM_BINS, &argmax) + argmax; break;
+            case 7:
+                kernels.stats(curr, prev, NUM_BINS, &stats);
+                sink += stats.weightedSum + stats.argmax;
+                break;
+            }
+        }
+        auto   end = std::chrono::steady_clock::now();
+        double ns  = std::chrono::duration<double, std::nano>(end - start).count() / numFrames;
+
+        if (csv) {
+            printf("kernel:%s:%s,%d,-,%.1f,%.0f,0,-\n", kernels.name, names[k], WINDOW_SIZE, ns, 1e9 / ns);
+        } else {
+            char name[64];
+            snprintf(name, sizeof(name), "%s (%s)", names[k], kernels.name);
+            printf("%-28s %6d %-10s %12.1f %14.0f %12s\n", name, WINDOW_SIZE, "-", ns, 1e9 / ns, "-");
+        }
+    }
+
+    // keep the results observable so the loops are not optimized away
+    if (sink == -1.0f) {
+        printf("\n");
+    }
+}
+
+// normalized entropy of a window, as computed by spectral_stats(), with the
+// per-bin logarithm supplied by Log2
+template <float (*Log2)(float)>
+static float entropyWith(const float* window)
+{
+    float total = 0.0, info = 0.0;
+    for (int i = 0; i < NUM_BINS; i++) {
+        float a = window[i];
+        total += a;
+        info += a > 0.0f ? a * Log2(a) : 0.0f;
+    }
+    if (total <= 0.0f) {
+        return 0.0f;
+    }
+    return (log2f(total) - info / total) / log2f(NUM_BINS);
+}
+
+// reference entropy in double precision
+static double entropyReference(const float* window)
+{
+    double total = 0.0, entropy = 0.0;
+    for (int i = 0; i < NUM_BINS; i++) {
+        total += window[i];
+    }
+    for (int i = 0; i < NUM_BINS; i++) {
+        if (window[i] > 0) {
+            double p = window[i] / total;
+            entropy -= p * log2(p);
+        }
+    }
+    return entropy / log2(NUM_BINS);
+}
+
+static float libmLog2(float x) { return log2f(x); }
+
+// time the entropy of a full window with the C library's log2f() and with
+// AudioPrism::fast_log2(), and report the largest error of each
+template <float (*Log2)(float)>
+static void benchEntropy(const char* name, const std::vector<float>& spectra, int numFrames,
+    bool csv)
+{
+    int    numSpectra = spectra.size() / NUM_BINS;
+    double maxError   = 0.0;
+    for (int f = 0; f < numSpectra; f++) {
+        const float* window = spectra.data() + f * NUM_BINS;
+        double       error  = fabs(entropyWith<Log2>(window) - entropyReference(window));
+        if (error > maxError) {
+            maxError = error;
+        }
+    }
+
+    float sink  = 0.0;
+    auto  start = std::chrono::steady_clock::now();
+    for (int f = 0; f < numFrames; f++) {
+        sink += entropyWith<Log2>(spectra.data() + (f % numSpectra) * NUM_BINS);
+    }
+    auto   end = std::chrono::steady_clock::now();
+    double ns  = std::chrono::duration<double, std::nano>(end - start).count() / numFrames;
+
+    if (csv) {
+        printf("%s,%d,-,%.1f,%.0f,0,%.2e\n", name, WINDOW_SIZE, ns, 1e9 / ns, maxError);
+    } else {
+        printf("%-28s %6d %-10s %12.1f %14.0f %12s  max error %.2e\n", name, WINDOW_SIZE, "-",
+            ns, 1e9 / ns, "-", maxError);
+    }
+
+    if (sink == -1.0f) {
+        printf("\n");
+    }
+}
+
+// the front end RealFFT replaces, as done with ArduinoFFT: a complex FFT of
+// the windowed real samples with twiddles from a recurrence, the magnitudes,
+// then a copy into the spectrogram
+static void complexFFTReference(const float* samples, const float* window, float* re, float* im,
+    Spectrogram* spectrogram)
+{
+    for (int i = 0; i < WINDOW_SIZE; i++) {
+        re[i] = samples[i] * window[i];
+        im[i] = 0.0;
+    }
+
+    for (int i = 1, j = 0; i < WINDOW_SIZE; i++) {
+        int bit = WINDOW_SIZE >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float t = re[i];
+            re[i]   = re[j];
+            re[j]   = t;
+        }
+    }
+    for (int len = 2; len <= WINDOW_SIZE; len <<= 1) {
+        float stepR = cos(-2.0 * M_PI / len);
+        float stepI = sin(-2.0 * M_PI / len);
+        float wr    = 1.0;
+        float wi    = 0.0;
+        for (int k = 0; k < (len >> 1); k++) {
+            for (int i = k; i < WINDOW_SIZE; i += len) {
+                int   j  = i + (len >> 1);
+                float xr = re[j] * wr - im[j] * wi;
+                float xi = re[j] * wi + im[j] * wr;
+                re[j]    = re[i] - xr;
+                im[j]    = im[i] - xi;
+                re[i] += xr;
+                im[i] += xi;
+            }
+            float t = wr * stepR - wi * stepI;
+            wi      = wr * stepI + wi * stepR;
+            wr      = t;
+        }
+    }
+
+    for (int i = 0; i < NUM_BINS; i++) {
+        re[i] = sqrt(re[i] * re[i] + im[i] * im[i]);
+    }
+    spectrogram->pushWindow(re);
+}
+
+// time the built-in RealFFT front end against the complex FFT it replaces,
+// from samples to a pushed spectrogram window
+static void benchFFT(int numFrames, bool csv)
+{
+    std::vector<float> samples(WINDOW_SIZE);
+    for (int i = 0; i < WINDOW_SIZE; i++) {
+        samples[i] = 8000.0 * sin(2.0 * M_PI * 440.0 * i / SAMPLE_RATE) + float(rand() % 2000 - 1000);
+    }
+    std::vector<float> re(WINDOW_SIZE), im(WINDOW_SIZE), window(WINDOW_SIZE);
+    for (int i = 0; i < WINDOW_SIZE; i++) {
+        window[i] = 0.54 - 0.46 * cos(2.0 * M_PI * i / (WINDOW_SIZE - 1));
+    }
+    Spectrogram        spectrogram = Spectrogram(2);
+    RealFFT            fft         = RealFFT(WINDOW_HAMMING);
+
+    for (int k = 0; k < 2; k++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < numFrames; f++) {
+            if (k == 0) {
+                fft.pushWindow(samples.data(), &spectrogram);
+            } else {
+                complexFFTReference(samples.data(), window.data(), re.data(), im.data(), &spectrogram);
+            }
+        }
+        auto        end  = std::chrono::steady_clock::now();
+        double      ns   = std::chrono::duration<double, std::nano>(end - start).count() / numFrames;
+        const char* name = k == 0 ? "RealFFT" : "complex FFT (ref)";
+
+        if (csv) {
+            printf("fft:%s,%d,-,%.1f,%.0f,0,-\n", name, WINDOW_SIZE, ns, 1e9 / ns);
+        } else {
+            printf("%-28s %6d %-10s %12.1f %14.0f %12s\n", name, WINDOW_SIZE, "-", ns, 1e9 / ns, "-");
+        }
+    }
+}
+
+// a heavy ModuleGroup wrapped as a module, so runBench() can time it serially
+// and on a thread pool; its modules are registered as submodules to follow the
+// benchmark's spectrogram
+class HeavyGroup : public ModuleInterface<int> {
+public:
+    HeavyGroup(ThreadPool* pool)
+        : group(NULL)
+    {
+        int bands[] = { 0, 100, 200, 400, 800, 1600, 2400, 3200, SAMPLE_RATE >> 1 };
+        for (int i = 0; i < 4; i++) {
+            this->slicers[i].setBands(bands, 8);
+        }
+
+        AnalysisModule* modules[] = { &this->formants, &this->majorPeaks, &this->salientFreqs,
+            &this->slicers[0], &this->slicers[1], &this->slicers[2], &this->slicers[3] };
+        for (AnalysisModule* module : modules) {
+            this->group.addModule(module);
+            this->addSubmodule(module);
+        }
+        this->group.setThreadPool(pool);
+    }
+
+    void doAnalysis() { this->group.runAnalysis(); }
+
+private:
+    ModuleGroup  group;
+    Formants     formants     = Formants();
+    MajorPeaks   majorPeaks   = MajorPeaks(8);
+    SalientFreqs salientFreqs = SalientFreqs(16);
+    BreadSlicer  slicers[4];
+};
+
+// a 64 band layout alongside per-range modules over overlapping ranges, the
+// case a prefix-sum index serves: every range sum is two lookups instead of
+// a pass over its bins
+class RangeGroup : public ModuleInterface<int> {
+public:
+    RangeGroup()
+        : group(NULL)
+    {
+        int bands[65];
+        for (int i = 0; i <= 64; i++) {
+            bands[i] = i * (SAMPLE_RATE >> 1) / 64;
+        }
+        this->slicer.setBands(bands, 64);
+        this->group.addModule(&this->slicer);
+        this->addSubmodule(&this->slicer);
+
+        // octave-like ranges, each nested in the next
+        for (int i = 0; i < 8; i++) {
+            int upperFreq = (SAMPLE_RATE >> 1) >> (7 - i);
+            this->totals[i].setAnalysisRangeByFreq(0, upperFreq);
+            this->means[i].setAnalysisRangeByFreq(upperFreq >> 1, upperFreq);
+            this->group.addModule(&this->totals[i]);
+            this->group.addModule(&this->means[i]);
+            this->addSubmodule(&this->totals[i]);
+            this->addSubmodule(&this->means[i]);
+        }
+    }
+
+    void doAnalysis() { this->group.runAnalysis(); }
+
+private:
+    ModuleGroup    group;
+    BreadSlicer    slicer;
+    TotalAmplitude totals[8];
+    MeanAmplitude  means[8];
+};
+
+// cache-backed modules over distinct ranges, each a FeatureCache miss per
+// frame, so run on a thread pool their passes overlap
+class CacheGroup : public ModuleInterface<int> {
+public:
+    CacheGroup(ThreadPool* pool)
+        : group(NULL)
+    {
+        for (int i = 0; i < 8; i++) {
+            int lowerFreq = i * (SAMPLE_RATE >> 1) / 8;
+            int upperFreq = (i + 1) * (SAMPLE_RATE >> 1) / 8;
+            this->noisiness[i].setAnalysisRangeByFreq(lowerFreq, upperFreq);
+            this->centroids[i].setAnalysisRangeByFreq(lowerFreq, upperFreq);
+            this->percussion[i].setAnalysisRangeByFreq(lowerFreq, upperFreq);
+            AnalysisModule* modules[] = { &this->noisiness[i], &this->centroids[i], &this->percussion[i] };
+            for (AnalysisModule* module : modules) {
+                this->group.addModule(module);
+                this->addSubmodule(module);
+            }
+        }
+        this->group.setThreadPool(pool);
+    }
+
+    void doAnalysis() { this->group.runAnalysis(); }
+
+private:
+    ModuleGroup         group;
+    Noisiness           noisiness[8];
+    Centroid            centroids[8];
+    PercussionDetection percussion[8];
+};
+
+static void printResult(const char* name, const char* input, BenchResult result, bool csv)
+{
+    if (csv) {
+        printf("%s,%d,%s,%.1f,%.0f,%.2f,-\n", name, WINDOW_SIZE, input,
+            result.nsPerFrame, result.framesPerSec, result.allocsPerFrame);
+    } else {
+        printf("%-28s %6d %-10s %12.1f %14.0f %12.2f\n", name, WINDOW_SIZE, input,
+            result.nsPerFrame, result.framesPerSec, result.allocsPerFrame);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool        csv       = false;
+    int         numFrames = 0;
+    const char* inputPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            numFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            inputPath = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--csv] [--frames N] [--input FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // keep the work per module roughly constant across window sizes
+    if (numFrames <= 0) {
+        numFrames = 4000000 / NUM_BINS;
+    }
+
+    std::vector<float> spectra;
+    const char*        input = inputPath ? "recorded" : "synthetic";
+    if (inputPath != NULL) {
+        if (!loadRecordedSpectra(inputPath, spectra)) {
+            return 1;
+        }
+    } else {
+        makeSyntheticSpectra(spectra);
+    }
+
+    // modules must not print while being timed
+    Serial.setSink(NULL);
+
+    int bands[] = { 0, 100, 200, 400, 800, 1600, 2400, 3200, SAMPLE_RATE >> 1 };
+
+    MaxAmplitude        maxAmplitude   = MaxAmplitude();
+    TotalAmplitude      totalAmplitude = TotalAmplitude();
+    MeanAmplitude       meanAmplitude  = MeanAmplitude();
+    Centroid            centroid       = Centroid();
+    Noisiness           noisiness      = Noisiness();
+    DeltaAmplitudes     deltaAmps      = DeltaAmplitudes();
+    SalientFreqs        salientFreqs   = SalientFreqs(16);
+    PercussionDetection percussion     = PercussionDetection();
+    MajorPeaks          majorPeaks     = MajorPeaks(8);
+    Formants            formants       = Formants();
+    BreadSlicer         breadSlicer    = BreadSlicer();
+    breadSlicer.setBands(bands, 8);
+    Filterbank          melBank        = Filterbank();
+    melBank.setBands(SCALE_MEL, 40, 0, SAMPLE_RATE >> 1);
+    MFCC                mfcc           = MFCC();
+
+    // compile-time specialized counterparts, over the full window
+    FixedTotalAmplitude<>               fixedTotal    = FixedTotalAmplitude<>();
+    FixedMeanAmplitude<>                fixedMean     = FixedMeanAmplitude<>();
+    FixedMaxAmplitude<>                 fixedMax      = FixedMaxAmplitude<>();
+    FixedCentroid<>                     fixedCentroid = FixedCentroid<>();
+    FixedBreadSlicer<FixedContext<>, 8> fixedSlicer;
+    fixedSlicer.setBands(bands);
+
+    struct {
+        const char*     name;
+        AnalysisModule* module;
+    } cases[] = {
+        { "pushWindow (baseline)", NULL },
+        { "MaxAmplitude", &maxAmplitude },
+        { "TotalAmplitude", &totalAmplitude },
+        { "MeanAmplitude", &meanAmplitude },
+        { "Centroid", &centroid },
+        { "Noisiness", &noisiness },
+        { "DeltaAmplitudes", &deltaAmps },
+        { "SalientFreqs(16)", &salientFreqs },
+        { "PercussionDetection", &percussion },
+        { "MajorPeaks(8)", &majorPeaks },
+        { "Formants", &formants },
+        { "BreadSlicer(8)", &breadSlicer },
+        { "Filterbank(40 mel)", &melBank },
+        { "MFCC(13)", &mfcc },
+        { "FixedMaxAmplitude", &fixedMax },
+        { "FixedTotalAmplitude", &fixedTotal },
+        { "FixedMeanAmplitude", &fixedMean },
+        { "FixedCentroid", &fixedCentroid },
+        { "FixedBreadSlicer(8)", &fixedSlicer },
+    };
+
+    if (csv) {
+        printf("module,window_size,input,ns_per_frame,frames_per_sec,allocs_per_frame,max_error\n");
+    } else {
+        printf("%-28s %6s %-10s %12s %14s %12s\n", "module", "window", "input",
+            "ns/frame", "frames/s", "allocs/frame");
+    }
+
+    for (auto& c : cases) {
+        printResult(c.name, input, runBench(c.module, spectra, numFrames), csv);
+    }
+
+    // the integer analysis path, with the largest magnitude at full scale
+    float fullScale = 0.0f;
+    for (float amp : spectra) {
+        fullScale = amp > fullScale ? amp : fullScale;
+    }
+    NoisinessQ15           noisinessQ15  = NoisinessQ15();
+    PercussionDetectionQ15 percussionQ15 = PercussionDetectionQ15();
+    printResult("NoisinessQ15", input, runBenchQ15(&noisinessQ15, spectra, numFrames, fullScale), csv);
+    printResult("PercussionDetectionQ15", input,
+        runBenchQ15(&percussionQ15, spectra, numFrames, fullScale), csv);
+
+    // many range sums per frame, summed bin by bin and from the Spectrogram's
+    // prefix sums
+    RangeGroup rangeGroup;
+    printResult("RangeGroup", input, runBench(&rangeGroup, spectra, numFrames), csv);
+    printResult("RangeGroup (prefix)", input, runBench(&rangeGroup, spectra, numFrames, true), csv);
+
+    // the same heavy group run serially and on a work-stealing pool with one
+    // thread per hardware thread
+    ThreadPool pool;
+    HeavyGroup serialGroup(NULL);
+    HeavyGroup parallelGroup(&pool);
+    char       parallelName[32];
+    snprintf(parallelName, sizeof(parallelName), "HeavyGroup (pool x%d)", pool.getNumThreads());
+    printResult("HeavyGroup (serial)", input, runBench(&serialGroup, spectra, numFrames), csv);
+    printResult(parallelName, input, runBench(&parallelGroup, spectra, numFrames), csv);
+
+    // the FeatureCache computes misses outside its lock, so the cache-backed
+    // modules of different ranges scale with the pool too
+    CacheGroup serialCacheGroup(NULL);
+    CacheGroup parallelCacheGroup(&pool);
+    snprintf(parallelName, sizeof(parallelName), "CacheGroup (pool x%d)", pool.getNumThreads());
+    printResult("CacheGroup (serial)", input, runBench(&serialCacheGroup, spectra, numFrames), csv);
+    printResult(parallelName, input, runBench(&parallelCacheGroup, spectra, numFrames), csv);
+
+    // every SpectralTools kernel set supported by this CPU, the active one
+    // is the widest
+    const AudioPrism::SpectralKernels* kernelSets[8];
+    int numKernelSets = AudioPrism::available_kernels(kernelSets, 8);
+    for (int i = 0; i < numKernelSets; i++) {
+        benchKernels(*kernelSets[i], spectra, numFrames, csv);
+    }
+
+    // the cache-backed modules with each kernel set installed, their misses
+    // run through the kernels, so this is the gain seen by a module
+    struct {
+        const char*     name;
+        AnalysisModule* module;
+    } kernelCases[] = {
+        { "TotalAmplitude", &totalAmplitude },
+        { "MeanAmplitude", &meanAmplitude },
+        { "MaxAmplitude", &maxAmplitude },
+        { "Centroid", &centroid },
+        { "Noisiness", &noisiness },
+        { "PercussionDetection", &percussion },
+    };
+    for (int i = 0; i < numKernelSets; i++) {
+        AudioPrism::set_kernels(*kernelSets[i]);
+        for (auto& c : kernelCases) {
+            char name[64];
+            snprintf(name, sizeof(name), "%s (%s)", c.name, kernelSets[i]->name);
+            printResult(name, input, runBench(c.module, spectra, numFrames), csv);
+        }
+    }
+    AudioPrism::set_kernels(*kernelSets[numKernelSets - 1]);
+
+    // FFT front end, timed over fewer frames since it costs more than most modules
+    benchFFT(numFrames / 8 + 1, csv);
+
+    // speed/accuracy tradeoff of the FAST_LOG2 option
+    benchEntropy<libmLog2>("entropy (log2f)", spectra, numFrames, csv);
+    benchEntropy<AudioPrism::fast_log2>("entropy (fast_log2)", spectra, numFrames, csv);
+
+    return 0;
+}
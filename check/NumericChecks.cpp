@@ -0,0 +1,457 @@
+/*
+ * @file
+ * Numerical checks of the AudioPrism front end and modules against double
+ * precision references.
+ *
+ * Each check runs a component over deterministic input, computes the same
+ * result directly from its definition in double precision, and compares the
+ * largest error with the accuracy the component is documented to reach. The
+ * process exits with a non-zero status if any check fails, so `ctest` (or
+ * running AudioPrismChecks directly) enforces the numerical contracts.
+ *
+ * Usage: AudioPrismChecks
+ */
+
+#include <cmath>
+#include <stdio.h>
+#include <vector>
+
+#include <AudioPrism.h>
+
+//============================================================================
+// HELPERS
+//============================================================================
+
+const int NUM_BINS = WINDOW_SIZE >> 1;
+
+// deterministic uniform values in [0, 1), the same on every platform
+static uint32_t randomState = 1;
+
+static double nextRandom()
+{
+    randomState = randomState * 1664525u + 1013904223u;
+    return (randomState >> 8) / double(1 << 24);
+}
+
+static int numFailures = 0;
+
+// prints one result line, and counts it if the error exceeds the limit
+static void report(const char* name, double error, double limit)
+{
+    bool ok = error <= limit;
+    printf("%-32s max error %.2e (limit %.0e) %s\n", name, error, limit, ok ? "ok" : "FAIL");
+    if (!ok) {
+        numFailures++;
+    }
+}
+
+//============================================================================
+// REAL FFT
+//============================================================================
+
+// RealFFT magnitudes against a direct DFT of the windowed samples, for every
+// window function and sizes from the smallest supported one to 4096 points.
+// The error is relative to the largest magnitude of the spectrum.
+static void checkRealFFT()
+{
+    const int      sizes[]     = { 4, 8, 64, 256, 1024, 4096 };
+    const char*    names[]     = { "rectangular", "hamming", "hann" };
+    WindowFunction functions[] = { WINDOW_RECTANGULAR, WINDOW_HAMMING, WINDOW_HANN };
+
+    for (int f = 0; f < 3; f++) {
+        double maxError = 0.0;
+        for (int n : sizes) {
+            RealFFT            fft(n, functions[f]);
+            std::vector<int>   samples(n);
+            std::vector<float> magnitudes(n / 2);
+            for (int i = 0; i < n; i++) {
+                samples[i] = int(nextRandom() * 2000.0) - 1000;
+            }
+            fft.compute(samples.data(), magnitudes.data());
+
+            std::vector<double> windowed(n);
+            for (int i = 0; i < n; i++) {
+                double ratio = double(i) / (n - 1);
+                double w     = 1.0;
+                if (functions[f] == WINDOW_HAMMING) {
+                    w = 0.54 - 0.46 * cos(2.0 * M_PI * ratio);
+                } else if (functions[f] == WINDOW_HANN) {
+                    w = 0.5 * (1.0 - cos(2.0 * M_PI * ratio));
+                }
+                windowed[i] = samples[i] * w;
+            }
+
+            std::vector<double> reference(n / 2);
+            double              peak = 0.0;
+            for (int k = 0; k < n / 2; k++) {
+                double re = 0.0, im = 0.0;
+                for (int i = 0; i < n; i++) {
+                    double angle = 2.0 * M_PI * double(k) * i / n;
+                    re += windowed[i] * cos(angle);
+                    im -= windowed[i] * sin(angle);
+                }
+                reference[k] = sqrt(re * re + im * im);
+                peak         = fmax(peak, reference[k]);
+            }
+            for (int k = 0; k < n / 2; k++) {
+                maxError = fmax(maxError, fabs(magnitudes[k] - reference[k]) / peak);
+            }
+        }
+
+        char name[48];
+        snprintf(name, sizeof(name), "RealFFT (%s)", names[f]);
+        report(name, maxError, 1e-6);
+    }
+}
+
+//============================================================================
+// FILTERBANK
+//============================================================================
+
+// weight of a triangle rising from lower to center and falling to upper (Hz)
+static double triangle(double freq, double lower, double center, double upper)
+{
+    if (freq <= lower || freq >= upper) {
+        return 0.0;
+    }
+    return freq <= center ? (freq - lower) / (center - lower) : (upper - freq) / (upper - center);
+}
+
+// a spectrum of uniform random amplitudes in a Spectrogram
+static void pushRandomWindow(Spectrogram* spectrogram, std::vector<float>& window)
+{
+    window.resize(NUM_BINS);
+    for (int i = 0; i < NUM_BINS; i++) {
+        window[i] = nextRandom() * 1000.0;
+    }
+    spectrogram->pushWindow(window.data());
+}
+
+// dense triangle weights over every bin, in double precision, for numBands
+// bands with the given numBands + 2 edges; returns the largest error of the
+// bank's output relative to each band
+static double filterbankError(Filterbank* bank, const std::vector<float>& window,
+    const std::vector<double>& edges, int numBands, bool power)
+{
+    double freqRes  = double(SAMPLE_RATE) / WINDOW_SIZE;
+    double maxError = 0.0;
+    for (int b = 0; b < numBands; b++) {
+        double reference = 0.0;
+        for (int i = 0; i < NUM_BINS; i++) {
+            double amp = power ? double(window[i]) * window[i] : window[i];
+            reference += triangle(i * freqRes, edges[b], edges[b + 1], edges[b + 2]) * amp;
+        }
+        maxError = fmax(maxError, fabs(bank->getOutput()[b] - reference) / reference);
+    }
+    return maxError;
+}
+
+// Filterbank outputs against dense triangle weights, for custom edges and for
+// mel bands, whose edges are spaced in double precision. The bands are wider
+// than a bin, so every triangle covers bins of the reference. The error is
+// relative to each band.
+static void checkFilterbank()
+{
+    Spectrogram        spectrogram(2);
+    std::vector<float> window;
+
+    int                 customEdges[] = { 0, 200, 500, 1000, 2000, SAMPLE_RATE >> 1 };
+    std::vector<double> edges(customEdges, customEdges + 6);
+    double              customError = 0.0;
+    Filterbank          custom;
+    custom.setSpectrogram(&spectrogram);
+    custom.setBands(customEdges, 4);
+    for (int frame = 0; frame < 16; frame++) {
+        pushRandomWindow(&spectrogram, window);
+        custom.doAnalysis();
+        customError = fmax(customError, filterbankError(&custom, window, edges, 4, false));
+    }
+    report("Filterbank (custom)", customError, 1e-5);
+
+    const int  numBands = 20;
+    double     upperMel = 2595.0 * log10(1.0 + (SAMPLE_RATE >> 1) / 700.0);
+    double     lowerMel = 2595.0 * log10(1.0 + 100.0 / 700.0);
+    double     melError = 0.0;
+    Filterbank mel;
+    mel.setSpectrogram(&spectrogram);
+    mel.setBands(SCALE_MEL, numBands, 100, SAMPLE_RATE >> 1);
+    mel.setPowerSpectrum(true);
+    edges.resize(numBands + 2);
+    for (int i = 0; i < numBands + 2; i++) {
+        double value = lowerMel + (upperMel - lowerMel) * i / (numBands + 1);
+        edges[i]     = 700.0 * (pow(10.0, value / 2595.0) - 1.0);
+    }
+    edges[0]            = 100;
+    edges[numBands + 1] = SAMPLE_RATE >> 1;
+    for (int frame = 0; frame < 16; frame++) {
+        pushRandomWindow(&spectrogram, window);
+        mel.doAnalysis();
+        melError = fmax(melError, filterbankError(&mel, window, edges, numBands, true));
+    }
+    report("Filterbank (mel, power)", melError, 1e-5);
+}
+
+//============================================================================
+// MFCC
+//============================================================================
+
+// MFCC coefficients against a reference computed from the definition: dense
+// mel triangles over the squared amplitudes, the floored natural log, and an
+// orthonormal DCT-II with directly evaluated cosines. The error is relative
+// to the largest coefficient of the frame: coefficient 0 is around 100 for
+// these spectra, where a float has a resolution of about 8e-6.
+static void checkMFCC()
+{
+    Spectrogram        spectrogram(2);
+    std::vector<float> window;
+
+    const int numCoeffs = 13;
+    const int numBands  = 40;
+    MFCC      mfcc(numCoeffs, numBands);
+    mfcc.setSpectrogram(&spectrogram);
+
+    std::vector<double> edges(numBands + 2);
+    double              upperMel = 2595.0 * log10(1.0 + (SAMPLE_RATE >> 1) / 700.0);
+    for (int i = 0; i < numBands + 2; i++) {
+        edges[i] = 700.0 * (pow(10.0, upperMel * i / (numBands + 1) / 2595.0) - 1.0);
+    }
+    edges[0]            = 0;
+    edges[numBands + 1] = SAMPLE_RATE >> 1;
+
+    double freqRes  = double(SAMPLE_RATE) / WINDOW_SIZE;
+    double maxError = 0.0;
+    for (int frame = 0; frame < 16; frame++) {
+        pushRandomWindow(&spectrogram, window);
+        mfcc.doAnalysis();
+
+        std::vector<double> logEnergies(numBands);
+        for (int b = 0; b < numBands; b++) {
+            double energy = 0.0;
+            for (int i = 0; i < NUM_BINS; i++) {
+                energy += triangle(i * freqRes, edges[b], edges[b + 1], edges[b + 2])
+                    * double(window[i]) * window[i];
+            }
+            logEnergies[b] = log(energy + 1e-10);
+        }
+        std::vector<double> coefficients(numCoeffs);
+        double              largest = 0.0;
+        for (int k = 0; k < numCoeffs; k++) {
+            double coefficient = 0.0;
+            for (int n = 0; n < numBands; n++) {
+                coefficient += logEnergies[n] * cos(M_PI * k * (n + 0.5) / numBands);
+            }
+            coefficients[k] = coefficient * sqrt((k == 0 ? 1.0 : 2.0) / numBands);
+            largest         = fmax(largest, fabs(coefficients[k]));
+        }
+        for (int k = 0; k < numCoeffs; k++) {
+            maxError = fmax(maxError, fabs(mfcc.getOutput()[k] - coefficients[k]) / largest);
+        }
+    }
+    report("MFCC (13 of 40 mel bands)", maxError, 1e-6);
+}
+
+//============================================================================
+// Q15 ANALYSIS PATH
+//============================================================================
+
+// normalized entropy of a spectrum by definition, empty bins skipped
+static double entropyReference(const float* window, int numBins)
+{
+    double total = 0.0;
+    for (int i = 0; i < numBins; i++) {
+        total += window[i];
+    }
+    if (total <= 0.0) {
+        return 0.0;
+    }
+
+    double entropy = 0.0;
+    for (int i = 0; i < numBins; i++) {
+        if (window[i] > 0.0f) {
+            double p = window[i] / total;
+            entropy -= p * log2(p);
+        }
+    }
+    return entropy / log2(double(numBins));
+}
+
+// NoisinessQ15 against the normalized entropy of the same quantized spectra,
+// and the decisions of PercussionDetectionQ15 against PercussionDetection.
+// The spectra alternate between noise, sparse peaks, a steep decay and noise
+// with empty bins, with silent and loud frames so percussion is detected.
+static void checkQ15()
+{
+    Spectrogram    spectrogram(2);
+    SpectrogramQ15 spectrogramQ15(2);
+    spectrogram.clearBuffer();
+    spectrogramQ15.clearBuffer();
+
+    NoisinessQ15           noisiness;
+    PercussionDetection    percussion(0.3, 0.05, 0.6);
+    PercussionDetectionQ15 percussionQ15(0.3, 0.05, 0.6);
+    noisiness.setSpectrogram(&spectrogramQ15);
+    percussion.setSpectrogram(&spectrogram);
+    percussionQ15.setSpectrogram(&spectrogramQ15);
+
+    std::vector<float>             window(NUM_BINS);
+    std::vector<AudioPrism::q15_t> windowQ15(NUM_BINS);
+    double                         maxError   = 0.0;
+    int                            mismatches = 0;
+    int                            detections = 0;
+    const int                      numFrames  = 3000;
+    for (int frame = 0; frame < numFrames; frame++) {
+        int kind = frame % 5;
+        for (int i = 0; i < NUM_BINS; i++) {
+            double v = nextRandom();
+            switch (kind) {
+            case 0: v *= 0.02; break;
+            case 1: v *= (i % 37 == 0) ? 0.9 : 0.001; break;
+            case 2: v = v * v * v * 0.1; break;
+            case 3: v = nextRandom() < 0.2 ? 0.0 : v * 0.05; break;
+            default: v *= (frame / 5) % 2 ? 0.5 : 0.0001; break;
+            }
+            window[i] = v;
+        }
+
+        // both paths analyze the same quantized spectrum
+        AudioPrism::q15_from_float_array(window.data(), windowQ15.data(), NUM_BINS, 1.0f);
+        for (int i = 0; i < NUM_BINS; i++) {
+            window[i] = AudioPrism::q15_to_float(windowQ15[i]);
+        }
+        spectrogram.pushWindow(window.data());
+        spectrogramQ15.pushWindow(windowQ15.data());
+
+        noisiness.doAnalysis();
+        percussion.doAnalysis();
+        percussionQ15.doAnalysis();
+
+        double entropy = AudioPrism::q15_to_float(noisiness.getOutput());
+        maxError       = fmax(maxError, fabs(entropy - entropyReference(window.data(), NUM_BINS)));
+        mismatches += percussion.getOutput() != percussionQ15.getOutput();
+        detections += percussion.getOutput();
+    }
+    report("NoisinessQ15 (entropy)", maxError, 7e-5);
+
+    printf("%-32s %d of %d frames differ (%d detections) %s\n", "PercussionDetectionQ15",
+        mismatches, numFrames, detections, mismatches == 0 && detections > 0 ? "ok" : "FAIL");
+    if (mismatches > 0 || detections == 0) {
+        numFailures++;
+    }
+}
+
+//============================================================================
+// SPECTRAL KERNELS
+//============================================================================
+
+// The max and stats kernels of every kernel set the CPU supports, against
+// sums in double precision. Sums are compared relative to their reference;
+// the maximum and its first index must match exactly. A float sum of n
+// terms is within about n * 6e-8 of the sum of its absolute terms, 2e-5 for
+// the longest range. Lengths cover empty
+// ranges and every vector tail, and some spectra contain repeated maxima,
+// negative values (which no maximum may report) and silence.
+static void checkKernels()
+{
+    const int MAX_BINS = 300;
+
+    const AudioPrism::SpectralKernels* sets[8];
+    int numSets = AudioPrism::available_kernels(sets, 8);
+
+    for (int s = 0; s < numSets; ++s) {
+        double error    = 0.0;
+        int    mismatch = 0;
+
+        for (int n = 0; n <= MAX_BINS; n += (n < 40 ? 1 : 37)) {
+            for (int shape = 0; shape < 4; ++shape) {
+                std::vector<float> curr(n), prev(n);
+                for (int i = 0; i < n; ++i) {
+                    curr[i] = float(nextRandom());
+                    prev[i] = float(nextRandom());
+                    if (shape == 1) {
+                        curr[i] = float(int(curr[i] * 4.0f)); // repeated maxima
+                    } else if (shape == 2) {
+                        curr[i] -= 1.0f; // all negative
+                    } else if (shape == 3) {
+                        curr[i] = 0.0f; // silence
+                    }
+                }
+
+                double sum = 0, energy = 0, weightedSum = 0, positiveFlux = 0, negativeFlux = 0;
+                float  maxVal = 0.0f;
+                int    argmax = -1;
+                for (int i = 0; i < n; ++i) {
+                    double d = double(curr[i]) - prev[i];
+                    sum += curr[i];
+                    energy += double(curr[i]) * curr[i];
+                    weightedSum += double(i) * curr[i];
+                    positiveFlux += d > 0 ? d * d : 0;
+                    negativeFlux += d < 0 ? d * d : 0;
+                    if (curr[i] > maxVal) {
+                        maxVal = curr[i];
+                        argmax = i;
+                    }
+                }
+
+                AudioPrism::KernelStats stats, noFlux;
+                sets[s]->stats(curr.data(), prev.data(), n, &stats);
+                sets[s]->stats(curr.data(), NULL, n, &noFlux);
+                int   kernelArgmax;
+                float kernelMax = sets[s]->max(curr.data(), n, &kernelArgmax);
+
+                // each sum relative to the sum of its absolute terms
+                double absSum = 0, absWeightedSum = 0, absEnergy = energy;
+                double flux = positiveFlux + negativeFlux;
+                for (int i = 0; i < n; ++i) {
+                    absSum += fabs(curr[i]);
+                    absWeightedSum += i * fabs(curr[i]);
+                }
+                absSum         = absSum > 0 ? absSum : 1;
+                absWeightedSum = absWeightedSum > 0 ? absWeightedSum : 1;
+                absEnergy      = absEnergy > 0 ? absEnergy : 1;
+                flux           = flux > 0 ? flux : 1;
+                double errors[] = {
+                    fabs(stats.sum - sum) / absSum,
+                    fabs(stats.energy - energy) / absEnergy,
+                    fabs(stats.weightedSum - weightedSum) / absWeightedSum,
+                    fabs(stats.positiveFlux - positiveFlux) / flux,
+                    fabs(stats.negativeFlux - negativeFlux) / flux,
+                    fabs(noFlux.weightedSum - stats.weightedSum) / absWeightedSum,
+                    fabs(noFlux.positiveFlux) + fabs(noFlux.negativeFlux),
+                };
+                for (size_t e = 0; e < sizeof(errors) / sizeof(errors[0]); ++e) {
+                    error = errors[e] > error ? errors[e] : error;
+                }
+
+                if (stats.max != maxVal || stats.argmax != argmax
+                    || kernelMax != maxVal || kernelArgmax != argmax) {
+                    mismatch++;
+                }
+            }
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "kernels %s stats", sets[s]->name);
+        report(name, error, 2e-5);
+        snprintf(name, sizeof(name), "kernels %s argmax", sets[s]->name);
+        report(name, mismatch, 0);
+    }
+}
+
+int main()
+{
+    Serial.setSink(NULL);
+
+    printf("AudioPrism numerical checks, WINDOW_SIZE=%d SAMPLE_RATE=%d\n", WINDOW_SIZE, SAMPLE_RATE);
+    checkRealFFT();
+    checkFilterbank();
+    checkMFCC();
+    checkQ15();
+    checkKernels();
+
+    if (numFailures > 0) {
+        printf("%d check(s) failed\n", numFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
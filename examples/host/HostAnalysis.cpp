@@ -0,0 +1,53 @@
+#include <AudioPrism.h>
+
+// This example runs a ModuleGroup natively on a host machine.
+// A synthetic spectrum stands in for FFT output: a decaying harmonic series
+// over a low noise floor, with a noise burst every 16th window. Each window is
+// written in place into the spectrogram's ring, without an intermediate copy.
+
+const int NUM_WINDOWS = 64;
+
+Spectrogram spectrogram = Spectrogram(2);
+ModuleGroup group       = ModuleGroup(&spectrogram);
+
+MajorPeaks          peaks      = MajorPeaks(4);
+Centroid            centroid   = Centroid();
+Noisiness           noisiness  = Noisiness();
+PercussionDetection percussion = PercussionDetection();
+
+void synthesizeWindow(float* window, int frame)
+{
+    bool burst = (frame % 16) == 0;
+
+    for (int i = 0; i < (WINDOW_SIZE >> 1); i++) {
+        window[i] = burst ? float(rand() % 4000) : float(rand() % 50);
+    }
+    for (int h = 1; h <= 6; h++) {
+        int bin = h * 8;
+        if (bin < (WINDOW_SIZE >> 1)) {
+            window[bin] += 20000.0 / h;
+        }
+    }
+}
+
+int main()
+{
+    spectrogram.clearBuffer();
+
+    group.addModule(&peaks);
+    group.addModule(&centroid);
+    group.addModule(&noisiness);
+    group.addModule(&percussion);
+
+    for (int frame = 0; frame < NUM_WINDOWS; frame++) {
+        synthesizeWindow(spectrogram.acquireWindow(), frame);
+        spectrogram.commitWindow();
+        group.runAnalysis();
+
+        Serial.printf("[%02d] peak: %6.1f Hz  centroid: %7.1f Hz  noise: %.3f  percussion: %d\n",
+            frame, peaks.getOutput()[MP_FREQ][0], centroid.getOutput(),
+            noisiness.getOutput(), percussion.getOutput());
+    }
+
+    return 0;
+}
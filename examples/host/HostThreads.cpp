@@ -0,0 +1,72 @@
+#include <AudioPrism.h>
+
+#include <thread>
+
+// This example splits a host pipeline across two threads through a
+// SharedSpectrogram: a producer thread synthesizes spectra (standing in for
+// capture and FFT) while the main thread runs a ModuleGroup on the latest
+// published window. Analysis of an overrun window is discarded.
+
+const int NUM_WINDOWS = 256;
+
+SharedSpectrogram spectrogram(4);
+ModuleGroup       group = ModuleGroup(&spectrogram);
+
+Centroid            centroid   = Centroid();
+PercussionDetection percussion = PercussionDetection();
+
+std::atomic<bool> producing(true);
+
+void produce()
+{
+    for (int frame = 0; frame < NUM_WINDOWS; frame++) {
+        float* window = spectrogram.acquireWindow();
+        for (int i = 0; i < (WINDOW_SIZE >> 1); i++) {
+            window[i] = float(rand() % 50);
+        }
+        window[(frame % 32) + 1] += 20000.0;
+        spectrogram.commitWindow();
+
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    producing.store(false);
+}
+
+int main()
+{
+    spectrogram.clearBuffer();
+
+    group.addModule(&centroid);
+    group.addModule(&percussion);
+
+    std::thread producer(produce);
+
+    int analyzed = 0, discarded = 0;
+    while (true) {
+        // check before updating, so the last window is not missed
+        bool done = !producing.load();
+        if (spectrogram.update() == 0) {
+            if (done) {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        group.runAnalysis();
+        if (spectrogram.isOverrun()) {
+            discarded++;
+            continue;
+        }
+
+        analyzed++;
+        Serial.printf("[%03u] centroid: %7.1f Hz  percussion: %d\n",
+            spectrogram.getFrameCount(), centroid.getOutput(), percussion.getOutput());
+    }
+
+    producer.join();
+    Serial.printf("analyzed: %d  discarded: %d  skipped: %u\n", analyzed, discarded,
+        spectrogram.getDroppedFrames());
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * @file
+ * Contains the compile-time analysis context used by fixed modules.
+ */
+
+#ifndef ANALYSIS_CONTEXT_H
+#define ANALYSIS_CONTEXT_H
+
+#include "AnalysisModule.h"
+#include "Config.h"
+
+/**
+ * An audio context and frequency range fixed at compile time.
+ *
+ * Fixed modules (FixedTotalAmplitude, FixedCentroid, ...) are templated on a
+ * context instead of reading the window size, sample rate and bin bounds from
+ * AnalysisModule at runtime. Every derived constant is constexpr, so the
+ * compiler knows the trip count of each analysis loop and can fully unroll
+ * and vectorize it.
+ *
+ * Frequencies are converted to bins by rounding to the nearest bin, like
+ * AnalysisModule::setAnalysisRangeByFreq().
+ *
+ * Ex. FixedContext<WINDOW_SIZE, 16384, 300, 3000>
+ *
+ * @tparam WindowSize The FFT window size, a positive power of 2.
+ * @tparam SampleRate The audio sample rate (Hz).
+ * @tparam LowerFreq The lower frequency bound to analyze (Hz).
+ * @tparam UpperFreq The upper frequency bound to analyze (Hz).
+ */
+template <int WindowSize = WINDOW_SIZE, int SampleRate = SAMPLE_RATE,
+    int LowerFreq = 0, int UpperFreq = (SampleRate >> 1)>
+struct FixedContext {
+    static_assert(WindowSize > 0 && (WindowSize & (WindowSize - 1)) == 0,
+        "Window size must be a positive power of 2.");
+    static_assert(SampleRate > 0, "Sample rate must be a positive number.");
+    static_assert(LowerFreq >= 0 && LowerFreq <= UpperFreq && UpperFreq <= (SampleRate >> 1),
+        "Invalid frequency range.");
+
+    static constexpr int   windowSize    = WindowSize;
+    static constexpr int   sampleRate    = SampleRate;
+    static constexpr int   windowSizeBy2 = WindowSize >> 1;
+    static constexpr float freqRes       = float(SampleRate) / float(WindowSize);
+    static constexpr float freqWidth     = float(WindowSize) / float(SampleRate);
+
+    // nearest bin to each frequency bound, in integer math
+    static constexpr int lowerBin = (2 * LowerFreq * WindowSize + SampleRate) / (2 * SampleRate);
+    static constexpr int upperBin = (2 * UpperFreq * WindowSize + SampleRate) / (2 * SampleRate);
+    static constexpr int numBins  = upperBin - lowerBin;
+
+    // nearest bin to any frequency, for use in constant expressions
+    static constexpr int freqToBin(int freq)
+    {
+        return (2 * freq * WindowSize + SampleRate) / (2 * SampleRate);
+    }
+};
+
+// out-of-class definitions, required in C++11 if a member is odr-used
+#define FIXED_CONTEXT_MEMBER(TYPE, NAME)                                  \
+    template <int WindowSize, int SampleRate, int LowerFreq, int UpperFreq> \
+    constexpr TYPE FixedContext<WindowSize, SampleRate, LowerFreq, UpperFreq>::NAME;
+
+FIXED_CONTEXT_MEMBER(int, windowSize)
+FIXED_CONTEXT_MEMBER(int, sampleRate)
+FIXED_CONTEXT_MEMBER(int, windowSizeBy2)
+FIXED_CONTEXT_MEMBER(float, freqRes)
+FIXED_CONTEXT_MEMBER(float, freqWidth)
+FIXED_CONTEXT_MEMBER(int, lowerBin)
+FIXED_CONTEXT_MEMBER(int, upperBin)
+FIXED_CONTEXT_MEMBER(int, numBins)
+
+#undef FIXED_CONTEXT_MEMBER
+
+/**
+ * Base class of the fixed modules.
+ *
+ * Mirrors the context into the AnalysisModule members, so fixed modules can
+ * be added to a ModuleGroup and print their info like any other module. The
+ * analysis only uses the compile-time context, so the window size, sample
+ * rate and analysis range setters are ignored, including when called by
+ * ModuleGroup::addModule, and the printed context is always the compiled one.
+ *
+ * The Spectrogram holds WINDOW_SIZE / 2 bins, so the context's window size
+ * must be WINDOW_SIZE, otherwise the analysis would read past its windows.
+ */
+template <typename T, class Context>
+class FixedModuleInterface : public ModuleInterface<T> {
+    static_assert(Context::windowSize == WINDOW_SIZE,
+        "The context's window size must be the Spectrogram's, WINDOW_SIZE.");
+
+public:
+    FixedModuleInterface()
+    {
+        this->sampleRate    = Context::sampleRate;
+        this->windowSize    = Context::windowSize;
+        this->windowSizeBy2 = Context::windowSizeBy2;
+        this->freqRes       = Context::freqRes;
+        this->freqWidth     = Context::freqWidth;
+        this->lowerBinBound = Context::lowerBin;
+        this->upperBinBound = Context::upperBin;
+    }
+
+    // the context is fixed at compile time
+    void setWindowSize(const int) { }
+    void setSampleRate(const int) { }
+    void setAnalysisRangeByFreq(int, int) { }
+    void setAnalysisRangeByBin(int, int) { }
+};
+
+#endif // ANALYSIS_CONTEXT_H
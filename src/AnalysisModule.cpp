@@ -1,5 +1,11 @@
 #include "AnalysisModule.h"
 
+#ifndef ARDUINO
+std::atomic<uint32_t> AnalysisModule::parameterVersion(0);
+#else
+uint32_t AnalysisModule::parameterVersion = 0;
+#endif
+
 void AnalysisModule::setWindowSize(int windowSize)
 {
     // window size must be a positive power of 2 to perform FFT
@@ -29,6 +35,7 @@ void AnalysisModule::setWindowSize(int windowSize)
 
     // update window size
     this->windowSize = windowSize;
+    parametersChanged();
 
     // recursive propagate window size change to submodules
     for (AnalysisModule* submodule : submodules) {
@@ -60,6 +67,7 @@ void AnalysisModule::setSampleRate(const int sampleRate)
 
     // update sample rate
     this->sampleRate = sampleRate;
+    parametersChanged();
 
     // recursively propagate sample rate change to submodules
     for (AnalysisModule* submodule : submodules) {
@@ -70,6 +78,7 @@ void AnalysisModule::setSampleRate(const int sampleRate)
 void AnalysisModule::setSpectrogram(Spectrogram* spectrogram)
 {
     this->spectrogram = spectrogram;
+    parametersChanged();
 
     // recursively propagate spectrogram change to submodules
     for (AnalysisModule* submodule : submodules) {
@@ -100,6 +109,7 @@ void AnalysisModule::setAnalysisRangeByFreq(int lowerFreq, int upperFreq)
     // convert frequencies to bin indices
     lowerBinBound = round(lowerFreq * freqWidth);
     upperBinBound = round(upperFreq * freqWidth);
+    parametersChanged();
 
     for (AnalysisModule* submodule : submodules) {
         submodule->setAnalysisRangeByBin(lowerBinBound, upperBinBound);
@@ -117,6 +127,7 @@ void AnalysisModule::setAnalysisRangeByBin(int lowerBin, int upperBin)
     // convert frequencies to bin indices
     lowerBinBound = lowerBin;
     upperBinBound = upperBin;
+    parametersChanged();
 
     for (AnalysisModule* submodule : submodules) {
         submodule->setAnalysisRangeByBin(lowerBinBound, upperBinBound);
@@ -150,3 +161,68 @@ void AnalysisModule::printModuleInfo()
     Serial.printf("Upper Bin Bound: %d (%d Hz)\n", upperBinBound, upperBinBound * sampleRate / windowSize);
     Serial.printf("Number of Submodules: %d\n", submodules.size());
 }
+
+void AnalysisModule::analyze()
+{
+    // the source runs the analysis, getOutput() returns its results
+    if (this->source != NULL) {
+        this->source->analyze();
+        return;
+    }
+
+    // a shared or lazy module is analyzed by the first of its users in each frame
+    if ((this->shared || this->lazy) && this->spectrogram != NULL) {
+        uint32_t frame = this->spectrogram->getFrameCount();
+        if (this->analyzed && this->analyzedFrame == frame) {
+            return;
+        }
+        this->doAnalysis();
+        this->analyzed      = true;
+        this->analyzedFrame = frame;
+        return;
+    }
+
+    this->doAnalysis();
+}
+
+void AnalysisModule::analyzeBatch(const float* frames, int numFrames, float* features, int stride)
+{
+    if (this->spectrogram == NULL) {
+        Serial.printf("Error: analyzeBatch() requires a spectrogram.\n");
+        return;
+    }
+    if (this->spectrogram->isShared()) {
+        Serial.printf("Error: analyzeBatch() cannot push windows to a SharedSpectrogram.\n");
+        return;
+    }
+    if (stride <= 0) {
+        stride = numFrames;
+    }
+
+    int savedDebugMode = this->debugMode;
+    this->setDebugMode(0);
+
+    int numBins = this->spectrogram->getNumBins();
+    for (int frame = 0; frame < numFrames; frame++) {
+        this->spectrogram->pushWindow(frames + frame * numBins);
+        this->analyze();
+        this->storeFeatures(features + frame, stride);
+    }
+
+    this->setDebugMode(savedDebugMode);
+}
+
+bool AnalysisModule::hasSameContext(const AnalysisModule* other) const
+{
+    return this->spectrogram == other->spectrogram
+        && this->sampleRate == other->sampleRate
+        && this->windowSize == other->windowSize
+        && this->lowerBinBound == other->lowerBinBound
+        && this->upperBinBound == other->upperBinBound;
+}
+
+bool AnalysisModule::isEquivalent(const AnalysisModule* other) const
+{
+    const void* typeTag = this->getTypeTag();
+    return typeTag != NULL && typeTag == other->getTypeTag() && this->hasSameContext(other);
+}
@@ -6,18 +6,46 @@
 #ifndef ANALYSIS_MODULE_H
 #define ANALYSIS_MODULE_H
 
-#include <Arduino.h>
 #include <math.h>
 #include <vector>
+#ifndef ARDUINO
+#include <atomic>
+#endif
 
 #include "Config.h"
+#include "Platform.h"
 #include "Spectrogram.h"
 
 #define DEBUG_ENABLE    0x01
 #define DEBUG_VERBOSE   0x02
 #define DEBUG_RECURSIVE 0x04
 
+// identifies a module type without RTTI, see AnalysisModule::getTypeTag()
+template <class T>
+inline const void* module_type_tag()
+{
+    static const char tag = 0;
+    return &tag;
+}
+
+// stores a scalar module output as one feature of a feature matrix, array
+// outputs have no default layout, see AnalysisModule::storeFeatures()
+template <typename T>
+struct ScalarFeature {
+    static const int count = 1;
+    static void      store(T value, float* feature) { *feature = float(value); }
+};
+
+template <typename T>
+struct ScalarFeature<T*> {
+    static const int count = 0;
+    static void      store(T*, float*) { }
+};
+
 class AnalysisModule {
+    // ModuleGroup links equivalent modules so they are only analyzed once
+    friend class ModuleGroup;
+
 protected:
     // audio context
     int sampleRate = SAMPLE_RATE;
@@ -40,16 +68,105 @@ protected:
     // debug mode for an analysis module
     int debugMode = 0x00;
 
+    // equivalent module whose results this module shares, set by a ModuleGroup
+    // NULL if this module runs its own analysis
+    AnalysisModule* source = NULL;
+
+    // whether other modules share the results of this module, in which case
+    // it is analyzed at most once per spectrogram frame
+    bool shared = false;
+
+    // whether the module is only analyzed when its output is read
+    bool lazy = false;
+
+    // frame of the last analysis of a shared or lazy module
+    bool     analyzed      = false;
+    uint32_t analyzedFrame = 0;
+
+    // whether other has the same audio context, spectrogram and analysis range
+    bool hasSameContext(const AnalysisModule* other) const;
+
+    // incremented by parametersChanged(), a ModuleGroup rebuilds its sharing
+    // links when it differs from the version they were built at
+#ifndef ARDUINO
+    static std::atomic<uint32_t> parameterVersion;
+#else
+    static uint32_t parameterVersion;
+#endif
+
+    // marks a change of the audio context, spectrogram, analysis range or
+    // parameters of the module, so equivalent modules are found again by the
+    // next ModuleGroup::runAnalysis(); until then the module runs its own
+    // analysis instead of returning the results of a module it no longer
+    // matches
+    // setters of parameters compared by isEquivalent() must call it
+    void parametersChanged()
+    {
+        this->source = NULL;
+        parameterVersion++;
+    };
+
 public:
+    // modules may be deleted through a base class pointer
+    virtual ~AnalysisModule() { };
+
     // pure virtual function to be implemented by dervied classes
     virtual void doAnalysis() = 0;
 
+    // runs doAnalysis(), unless the results of an equivalent module in the
+    // same ModuleGroup can be reused, or a shared or lazy module was already
+    // analyzed in the current spectrogram frame
+    // parent modules must analyze their submodules with this function
+    void analyze();
+
+    // in lazy mode, the module is skipped by ModuleGroup::runAnalysis() and
+    // analyzed by the first call to getOutput() in each spectrogram frame, so
+    // outputs that are not read are not computed and repeated reads are free
+    // lazy modules must have a spectrogram, and their outputs must be read from
+    // one thread at a time
+    // modules that cannot be lazy override it to ignore the setting
+    virtual void setLazy(bool lazy) { this->lazy = lazy; };
+    bool isLazy() const { return this->lazy; };
+
+    // identifies the type of the module, modules returning NULL are never shared
+    // shareable modules return module_type_tag<ModuleClass>() and are final,
+    // so no subclass with another analysis can inherit their tag and be
+    // shared with them
+    virtual const void* getTypeTag() const { return NULL; };
+
+    // whether other always produces the same output as this module
+    // by default, modules of the same shareable type with the same context are
+    // equivalent, modules with parameters must also compare them
+    virtual bool isEquivalent(const AnalysisModule* other) const;
+
+    // number of features the output of the module is stored as by
+    // storeFeatures(), 0 if the output cannot be stored
+    // scalar outputs are one feature, modules with array outputs override it
+    virtual int getNumFeatures() { return 0; };
+
+    // stores the features of the current output in a feature matrix, feature i
+    // of the output is written to features[i * stride]
+    virtual void storeFeatures(float* /* features */, int /* stride */) { };
+
+    // analyzes numFrames consecutive windows of the spectrogram's size stored
+    // contiguously in frames, and stores the output of each frame in a
+    // columnar feature matrix: feature i of frame f is written to
+    // features[i * stride + f], with stride = numFrames if not given
+    // the windows are pushed to the module's spectrogram, so the first window
+    // follows the current window of the spectrogram, as in a per-frame loop
+    // a convenience over that loop: each window is still copied into the
+    // spectrogram, debug output is disabled during the batch, and a
+    // SharedSpectrogram is refused as its windows come from its producer
+    void analyzeBatch(const float* frames, int numFrames, float* features, int stride = 0);
+
     // set the window size of the analysis module
     // must be a positive power of 2
-    void setWindowSize(const int windowSize);
+    // the audio context and range setters are virtual so modules with a fixed
+    // context can ignore them, see FixedModuleInterface
+    virtual void setWindowSize(const int windowSize);
 
     // set the sample rate of the analysis module
-    void setSampleRate(const int sampleRate);
+    virtual void setSampleRate(const int sampleRate);
 
     // set the spectrogram to use as input
     void setSpectrogram(Spectrogram* spectrogram);
@@ -59,8 +176,8 @@ public:
     void addSubmodule(AnalysisModule* module);
 
     // set the frequency range to analyze
-    void setAnalysisRangeByFreq(int lowerFreq, int upperFreq);
-    void setAnalysisRangeByBin(int lowerBin, int upperBin);
+    virtual void setAnalysisRangeByFreq(int lowerFreq, int upperFreq);
+    virtual void setAnalysisRangeByBin(int lowerBin, int upperBin);
 
     // enable debug mode
     void setDebugMode(int mode);
@@ -76,7 +193,43 @@ protected:
     T output; // result of most recent analysis
 
 public:
-    T getOutput() { return output; }
+    // a lazy module is analyzed on the first read in each frame
+    // a module sharing the results of an equivalent module returns its output
+    T getOutput()
+    {
+        if (this->lazy) {
+            this->analyze();
+        }
+        if (this->source != NULL) {
+            return static_cast<ModuleInterface<T>*>(this->source)->output;
+        }
+        return output;
+    }
+
+    int getNumFeatures() { return ScalarFeature<T>::count; };
+
+    void storeFeatures(float* features, int) { ScalarFeature<T>::store(getOutput(), features); };
+};
+
+// interface of the modules of the integer analysis path, see FixedPoint.h
+// Q15 modules read a SpectrogramQ15 instead of the float Spectrogram, which
+// only identifies the frame in a ModuleGroup. They are never shared with
+// other modules, and cannot be lazy
+template <typename T>
+class Q15ModuleInterface : public ModuleInterface<T> {
+protected:
+    SpectrogramQ15* spectrogramQ15 = NULL;
+
+public:
+    using AnalysisModule::setSpectrogram;
+
+    // set the Q15 spectrogram to use as input
+    void setSpectrogram(SpectrogramQ15* spectrogram) { this->spectrogramQ15 = spectrogram; };
+
+    // lazy analysis is keyed on the frame count of the float Spectrogram,
+    // which a group that only pushes Q15 windows never advances, so Q15
+    // modules stay eager, even in a lazy ModuleGroup
+    void setLazy(bool) { };
 };
 
 #endif // ANALYSIS_MODULE_H
@@ -3,15 +3,24 @@
 
 #include "SpectralTools.h"
 
+#include "AnalysisContext.h"
 #include "AnalysisModule.h"
+#include "FeatureCache.h"
+#include "FixedPoint.h"
 #include "ModuleGroup.h"
+#include "RealFFT.h"
+#include "STFT.h"
+#include "SharedSpectrogram.h"
 #include "Spectrogram.h"
+#include "ThreadPool.h"
 
 #include "modules/BreadSlicer.h"
 #include "modules/Centroid.h"
 #include "modules/DeltaAmplitudes.h"
+#include "modules/Filterbank.h"
 #include "modules/MajorPeaks.h"
 #include "modules/MaxAmplitude.h"
+#include "modules/MFCC.h"
 #include "modules/MeanAmplitude.h"
 #include "modules/Noisiness.h"
 #include "modules/PercussionDetection.h"
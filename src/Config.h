@@ -9,4 +9,15 @@
 #define WINDOW_SIZE 256
 #endif // WINDOW_SIZE
 
+// number of distinct bin ranges each Spectrogram's FeatureCache can hold per frame
+#ifndef FEATURE_CACHE_SIZE
+#define FEATURE_CACHE_SIZE 16
+#endif // FEATURE_CACHE_SIZE
+
+// use a polynomial approximation of log2 for entropy computations
+// (AudioPrism::fast_log2, absolute error < 2e-5) instead of the C library's
+#ifndef FAST_LOG2
+#define FAST_LOG2 0
+#endif // FAST_LOG2
+
 #endif // CONFIG_H
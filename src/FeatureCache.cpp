@@ -0,0 +1,235 @@
+#include "FeatureCache.h"
+
+#include "SpectralTools.h"
+#include "Spectrogram.h"
+
+FeatureCache::FeatureCache(const Spectrogram* spectrogram)
+{
+    this->spectrogram = spectrogram;
+    this->nextEntry   = 0;
+    this->generation  = 0;
+    for (int i = 0; i < FEATURE_CACHE_SIZE; i++) {
+        entries[i].computing = false;
+    }
+    invalidate();
+}
+
+float FeatureCache::getSum(int lowerBin, int upperBin)
+{
+    // with a prefix-sum index, any range sum is cheaper than a cache lookup
+    if (spectrogram->hasPrefixSums()) {
+        return spectrogram->getRangeSum(lowerBin, upperBin);
+    }
+    return get(FEATURE_SUM, lowerBin, upperBin);
+}
+
+float FeatureCache::getEnergy(int lowerBin, int upperBin)
+{
+    if (spectrogram->hasPrefixSums()) {
+        return spectrogram->getRangeEnergy(lowerBin, upperBin);
+    }
+    return get(FEATURE_ENERGY, lowerBin, upperBin);
+}
+
+float FeatureCache::getEntropy(int lowerBin, int upperBin)
+{
+    return get(FEATURE_ENTROPY, lowerBin, upperBin);
+}
+
+float FeatureCache::getMax(int lowerBin, int upperBin)
+{
+    return get(FEATURE_MAX, lowerBin, upperBin);
+}
+
+float FeatureCache::getWeightedSum(int lowerBin, int upperBin)
+{
+    return get(FEATURE_WEIGHTED_SUM, lowerBin, upperBin);
+}
+
+float FeatureCache::getFlux(int lowerBin, int upperBin)
+{
+    return get(FEATURE_FLUX, lowerBin, upperBin);
+}
+
+float FeatureCache::getPositiveFlux(int lowerBin, int upperBin)
+{
+    return get(FEATURE_POSITIVE_FLUX, lowerBin, upperBin);
+}
+
+float FeatureCache::getNegativeFlux(int lowerBin, int upperBin)
+{
+    return get(FEATURE_NEGATIVE_FLUX, lowerBin, upperBin);
+}
+
+void FeatureCache::invalidate()
+{
+#ifndef ARDUINO
+    std::lock_guard<std::mutex> guard(this->lock);
+#endif
+
+    for (int i = 0; i < FEATURE_CACHE_SIZE; i++) {
+        entries[i].validMask = 0;
+    }
+    this->generation++;
+}
+
+float FeatureCache::get(Feature feature, int lowerBin, int upperBin)
+{
+#ifndef ARDUINO
+    std::unique_lock<std::mutex> guard(this->lock);
+#endif
+
+    Entry* entry;
+    while (true) {
+        entry = lookup(lowerBin, upperBin);
+        if (entry == NULL || !entry->computing) {
+            break;
+        }
+        if (entry->validMask & (1 << feature)) {
+            return entry->values[feature];
+        }
+#ifndef ARDUINO
+        // another thread is computing the range, its pass may include the
+        // feature, otherwise this thread computes it once the entry is free
+        this->published.wait(guard);
+#endif
+    }
+
+    if (entry != NULL && (entry->validMask & (1 << feature))) {
+        return entry->values[feature];
+    }
+
+    // the pass runs outside the lock, the claimed entry is marked so it is
+    // neither reclaimed nor computed twice in the meantime
+    uint32_t generation = this->generation;
+    if (entry != NULL) {
+        entry->computing = true;
+    }
+#ifndef ARDUINO
+    guard.unlock();
+#endif
+
+    float    values[NUM_FEATURES];
+    uint16_t mask = compute(feature, lowerBin, upperBin, values);
+
+#ifndef ARDUINO
+    guard.lock();
+#endif
+    if (entry != NULL) {
+        if (generation == this->generation) {
+            for (int i = 0; i < NUM_FEATURES; i++) {
+                if (mask & (1 << i)) {
+                    entry->values[i] = values[i];
+                }
+            }
+            entry->validMask |= mask;
+        }
+        entry->computing = false;
+#ifndef ARDUINO
+        this->published.notify_all();
+#endif
+    }
+
+    return values[feature];
+}
+
+FeatureCache::Entry* FeatureCache::lookup(int lowerBin, int upperBin)
+{
+    uint32_t frame = spectrogram->getFrameCount();
+
+    for (int i = 0; i < FEATURE_CACHE_SIZE; i++) {
+        Entry* entry = &entries[i];
+        if ((entry->validMask != 0 || entry->computing) && entry->frame == frame
+            && entry->lowerBin == lowerBin && entry->upperBin == upperBin) {
+            return entry;
+        }
+    }
+
+    // no entry for this range in this frame, claim the next one that is not
+    // being computed
+    int tries = 0;
+    while (entries[nextEntry].computing) {
+        if (++tries == FEATURE_CACHE_SIZE) {
+            return NULL;
+        }
+        nextEntry++;
+        if (nextEntry == FEATURE_CACHE_SIZE) {
+            nextEntry = 0;
+        }
+    }
+
+    Entry* entry     = &entries[nextEntry];
+    entry->frame     = frame;
+    entry->lowerBin  = lowerBin;
+    entry->upperBin  = upperBin;
+    entry->validMask = 0;
+
+    nextEntry++;
+    if (nextEntry == FEATURE_CACHE_SIZE) {
+        nextEntry = 0;
+    }
+
+    return entry;
+}
+
+uint16_t FeatureCache::compute(Feature feature, int lowerBin, int upperBin, float* values) const
+{
+    const AudioPrism::SpectralKernels& kernels = AudioPrism::get_kernels();
+
+    const float* currWindow = spectrogram->getCurrentWindow();
+    int          numBins    = upperBin - lowerBin;
+
+    // a lone reduction only runs its own kernel, the fused pass costs several
+    // times as much and its other results are often never requested
+    switch (feature) {
+    case FEATURE_SUM:
+        values[FEATURE_SUM] = kernels.sum(currWindow + lowerBin, numBins);
+        return 1 << FEATURE_SUM;
+    case FEATURE_ENERGY:
+        values[FEATURE_ENERGY] = kernels.energy(currWindow + lowerBin, numBins);
+        return 1 << FEATURE_ENERGY;
+    case FEATURE_MAX: {
+        int argmax;
+        values[FEATURE_MAX] = kernels.max(currWindow + lowerBin, numBins, &argmax);
+        return 1 << FEATURE_MAX;
+    }
+    default:
+        break;
+    }
+
+    // the other features come from one pass of the fused statistics kernel,
+    // which also fills in the sum, energy and maximum of the range. Flux
+    // requires reading the previous window as well, and entropy requires a
+    // log2() per bin, so those are only computed when requested. Requesting
+    // the entropy computes everything, the flux is cheap next to its log2()
+    // calls and onset detectors ask for both.
+    bool withEntropy = (feature == FEATURE_ENTROPY);
+    bool withFlux    = withEntropy || feature == FEATURE_FLUX
+        || feature == FEATURE_POSITIVE_FLUX || feature == FEATURE_NEGATIVE_FLUX;
+
+    const float* prevWindow = withFlux ? spectrogram->getNonOverlappingWindow() : NULL;
+
+    AudioPrism::SpectralStats stats;
+    AudioPrism::spectral_stats(currWindow, prevWindow, lowerBin, upperBin, stats, withEntropy);
+
+    values[FEATURE_SUM]          = stats.sum;
+    values[FEATURE_ENERGY]       = stats.energy;
+    values[FEATURE_MAX]          = stats.max;
+    values[FEATURE_WEIGHTED_SUM] = stats.weightedSum;
+    uint16_t mask                = (1 << FEATURE_SUM) | (1 << FEATURE_ENERGY)
+        | (1 << FEATURE_MAX) | (1 << FEATURE_WEIGHTED_SUM);
+
+    if (withFlux) {
+        values[FEATURE_FLUX]          = stats.flux;
+        values[FEATURE_POSITIVE_FLUX] = stats.positiveFlux;
+        values[FEATURE_NEGATIVE_FLUX] = stats.negativeFlux;
+        mask |= (1 << FEATURE_FLUX) | (1 << FEATURE_POSITIVE_FLUX) | (1 << FEATURE_NEGATIVE_FLUX);
+    }
+
+    if (withEntropy) {
+        values[FEATURE_ENTROPY] = stats.entropy;
+        mask |= (1 << FEATURE_ENTROPY);
+    }
+
+    return mask;
+}
@@ -0,0 +1,156 @@
+/*
+ * @file
+ * Contains the FeatureCache class definition.
+ */
+
+#ifndef FEATURE_CACHE_H
+#define FEATURE_CACHE_H
+
+#include <cstdint>
+
+#ifndef ARDUINO
+#include <condition_variable>
+#include <mutex>
+#endif
+
+#include "Config.h"
+
+class Spectrogram;
+
+/**
+ * FeatureCache memoizes per-frame spectral reductions over bin ranges.
+ *
+ * Every Spectrogram owns a FeatureCache. The first module to request a
+ * feature for a bin range in the current frame computes it, later requests
+ * for the same range return the stored values. The sum, energy and maximum
+ * are computed alone by their SpectralKernels kernel. The weighted sum,
+ * flux and entropy come from a pass of AudioPrism::spectral_stats(), which
+ * also caches the sum, energy and maximum of the range (and the flux, for
+ * the entropy). Entries are tagged
+ * with the Spectrogram's frame count, so pushing a new window invalidates the
+ * whole cache without touching it.
+ *
+ * Bin ranges are half-open: [lowerBin, upperBin).
+ *
+ * On hosts, modules analyzing the same Spectrogram can run on a ThreadPool.
+ * A lock only guards finding or claiming an entry, the pass itself runs
+ * outside it, so threads computing different ranges run in parallel. A
+ * feature is still computed only once, whichever thread asks first: other
+ * threads requesting the same range wait for its pass to be published.
+ */
+class FeatureCache {
+public:
+    /**
+     * Creates an empty cache over the given Spectrogram.
+     *
+     * @param spectrogram The Spectrogram whose windows are reduced.
+     */
+    FeatureCache(const Spectrogram* spectrogram);
+
+    /**
+     * Gets the amplitude sum of the current window.
+     *
+     * Read from the Spectrogram's prefix-sum index if it has one, see
+     * Spectrogram::enablePrefixSums(), as is the energy.
+     */
+    float getSum(int lowerBin, int upperBin);
+
+    /**
+     * Gets the energy (sum of squared amplitudes) of the current window.
+     */
+    float getEnergy(int lowerBin, int upperBin);
+
+    /**
+     * Gets the normalized (0-1) spectral entropy of the current window.
+     *
+     * Uses the same formulation as AudioPrism::entropy().
+     */
+    float getEntropy(int lowerBin, int upperBin);
+
+    /**
+     * Gets the maximum amplitude in the current window.
+     */
+    float getMax(int lowerBin, int upperBin);
+
+    /**
+     * Gets the sum of bin index * amplitude of the current window.
+     *
+     * Divided by the amplitude sum, this is the spectral centroid in bins.
+     */
+    float getWeightedSum(int lowerBin, int upperBin);
+
+    /**
+     * Gets the spectral flux between the previous and current window.
+     */
+    float getFlux(int lowerBin, int upperBin);
+
+    /**
+     * Gets the positive (increasing) spectral flux between the previous and
+     * current window.
+     */
+    float getPositiveFlux(int lowerBin, int upperBin);
+
+    /**
+     * Gets the negative (decreasing) spectral flux between the previous and
+     * current window.
+     */
+    float getNegativeFlux(int lowerBin, int upperBin);
+
+    /**
+     * Discards all cached values.
+     *
+     * Called automatically when the Spectrogram is cleared. Must be called
+     * manually if window data is modified in place after it was pushed.
+     */
+    void invalidate();
+
+private:
+    enum Feature {
+        FEATURE_SUM = 0,
+        FEATURE_ENERGY,
+        FEATURE_ENTROPY,
+        FEATURE_MAX,
+        FEATURE_WEIGHTED_SUM,
+        FEATURE_FLUX,
+        FEATURE_POSITIVE_FLUX,
+        FEATURE_NEGATIVE_FLUX,
+        NUM_FEATURES
+    };
+
+    struct Entry {
+        uint32_t frame;
+        int      lowerBin;
+        int      upperBin;
+        uint16_t validMask; // bit n is set if values[n] is cached
+        bool     computing; // a thread is computing the range, outside the lock
+        float    values[NUM_FEATURES];
+    };
+
+    // returns the cached or freshly computed feature for the range
+    float get(Feature feature, int lowerBin, int upperBin);
+
+    // finds the entry for the range in the current frame, claiming one if
+    // needed, entries being computed are never claimed
+    // returns NULL if every entry is being computed
+    Entry* lookup(int lowerBin, int upperBin);
+
+    // computes the requested feature of the range, along with the other
+    // features of the fused pass if it needs one
+    // returns the mask of the features written to values
+    uint16_t compute(Feature feature, int lowerBin, int upperBin, float* values) const;
+
+    const Spectrogram* spectrogram;
+
+    Entry entries[FEATURE_CACHE_SIZE];
+    int   nextEntry; // next entry to claim, entries are replaced round robin
+
+    // incremented by invalidate(), so passes started before are not published
+    uint32_t generation;
+
+#ifndef ARDUINO
+    std::mutex              lock;
+    std::condition_variable published;
+#endif
+};
+
+#endif // FEATURE_CACHE_H
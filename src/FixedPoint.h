@@ -0,0 +1,231 @@
+/*
+ * @file
+ * Contains the fixed-point helpers of the integer analysis path.
+ */
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace AudioPrism {
+
+/**
+ * Q15 fixed-point numbers: a signed integer scaled by 2^-15, holding values
+ * in [-1, 1) with a resolution of about 3e-5.
+ *
+ * The integer analysis path (SpectrogramQ15 and the Q15 modules) runs on
+ * boards without an FPU, where every float operation is a library call. Its
+ * spectra hold Q15 magnitudes, which must not be negative. The inner loops
+ * only use 32 bit multiplies and 64 bit additions, and every accumulator is
+ * wide enough not to overflow for any window of up to 65535 bins. Results
+ * narrowed back to Q15 saturate instead of wrapping around.
+ */
+typedef int16_t q15_t;
+
+// 1.0 in Q15, and the largest Q15 value just below it
+const int32_t Q15_ONE = 32768;
+const int32_t Q15_MAX = 32767;
+
+/**
+ * Saturates a value to the Q15 range.
+ */
+inline q15_t q15_saturate(int32_t x)
+{
+    if (x > Q15_MAX) {
+        return Q15_MAX;
+    }
+    if (x < -Q15_ONE) {
+        return -Q15_ONE;
+    }
+    return (q15_t)x;
+}
+
+/**
+ * Converts a float to Q15, rounding to nearest and saturating to [-1, 1).
+ */
+inline q15_t q15_from_float(float x)
+{
+    float scaled = x * float(Q15_ONE);
+    if (scaled >= float(Q15_MAX)) {
+        return Q15_MAX;
+    }
+    if (scaled <= -float(Q15_ONE)) {
+        return -Q15_ONE;
+    }
+    return (q15_t)(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+}
+
+inline float q15_to_float(q15_t x) { return float(x) / float(Q15_ONE); }
+
+/**
+ * Converts float magnitudes to Q15, e.g. to fill a SpectrogramQ15 window on
+ * a board that computes its FFT in float, or on the host.
+ *
+ * @param data The float magnitudes
+ * @param out Output, the Q15 magnitudes
+ * @param n The number of bins
+ * @param fullScale The magnitude mapped to 1.0, larger ones saturate
+ */
+inline void q15_from_float_array(const float* data, q15_t* out, int n, float fullScale)
+{
+    float scale = 1.0f / fullScale;
+    for (int i = 0; i < n; i++) {
+        out[i] = q15_from_float(data[i] * scale);
+    }
+}
+
+/**
+ * Approximate the base 2 logarithm of a positive integer, in Q16.16.
+ *
+ * The integer part is the position of the highest set bit. The fraction is
+ * interpolated linearly from a table of log2(1 + i / 32), indexed by the 5
+ * bits below it, with an absolute error below 2e-4.
+ *
+ * @param x The value to take the logarithm of, 0 returns 0
+ */
+inline uint32_t ilog2_q16(uint32_t x)
+{
+    static const uint32_t table[33] = {
+        0, 2909, 5732, 8473, 11136, 13727, 16248, 18704,
+        21098, 23433, 25711, 27936, 30109, 32234, 34312, 36346,
+        38336, 40286, 42196, 44068, 45904, 47705, 49472, 51207,
+        52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047,
+        65536,
+    };
+
+    if (x == 0) {
+        return 0;
+    }
+
+    // shift the highest set bit to bit 31, the mantissa follows it
+    int      exponent = 31 - __builtin_clz(x);
+    uint32_t mantissa = x << (31 - exponent);
+    uint32_t index    = (mantissa >> 26) & 0x1f;
+    uint32_t frac     = (mantissa >> 10) & 0xffff;
+
+    uint32_t lower = table[index];
+    return ((uint32_t)exponent << 16) + lower + (((table[index + 1] - lower) * frac) >> 16);
+}
+
+/**
+ * Statistics of a Q15 spectrum over a bin range, see spectral_stats_q15().
+ *
+ * Sums of amplitudes are in Q15 units (a sum of 32768 is 1.0), sums of
+ * squares in Q30 units.
+ */
+struct SpectralStatsQ15 {
+    uint32_t sum;          // amplitude sum
+    uint64_t energy;       // sum of squared amplitudes
+    q15_t    max;          // maximum amplitude
+    int      argmax;       // bin index of the maximum amplitude, -1 if all bins are 0
+    uint64_t weightedSum;  // sum of bin index * amplitude (centroid numerator, in bins)
+    uint64_t flux;         // sum of squared differences from the previous window
+    uint64_t positiveFlux; // flux of the bins that increased in amplitude
+    uint64_t negativeFlux; // flux of the bins that decreased in amplitude
+    q15_t    entropy;      // normalized (0-1) spectral entropy
+};
+
+// single pass over [lowerBin, upperBin) for spectral_stats_q15(), the optional
+// statistics are template parameters so their branches are compiled out
+template <bool WithFlux, bool WithEntropy>
+inline void spectral_stats_q15_pass(const q15_t* currWindow, const q15_t* prevWindow,
+    int lowerBin, int upperBin, SpectralStatsQ15& stats, uint64_t& selfInformation)
+{
+    uint32_t sum = 0;
+    uint64_t energy = 0, weightedSum = 0, positiveFlux = 0, negativeFlux = 0, info = 0;
+    q15_t    maxVal = 0;
+    int      argmax = -1;
+
+    for (int i = lowerBin; i < upperBin; i++) {
+        int32_t amp = currWindow[i];
+
+        sum += amp;
+        energy += (uint32_t)(amp * amp);
+        weightedSum += (uint32_t)(i * amp);
+        if (amp > maxVal) {
+            maxVal = amp;
+            argmax = i;
+        }
+
+        if (WithFlux) {
+            int32_t diff = amp - prevWindow[i];
+            if (diff > 0) {
+                positiveFlux += (uint32_t)(diff * diff);
+            } else {
+                negativeFlux += (uint32_t)(diff * diff);
+            }
+        }
+
+        if (WithEntropy) {
+            // log2 in Q11, so the product fits in 32 bits
+            info += (uint32_t)amp * (ilog2_q16(amp) >> 5);
+        }
+    }
+
+    stats.sum          = sum;
+    stats.energy       = energy;
+    stats.max          = maxVal;
+    stats.argmax       = argmax;
+    stats.weightedSum  = weightedSum;
+    stats.positiveFlux = positiveFlux;
+    stats.negativeFlux = negativeFlux;
+    stats.flux         = positiveFlux + negativeFlux;
+    selfInformation    = info;
+}
+
+/**
+ * Calculate several statistics of a Q15 spectrum over a bin range in one
+ * pass, like spectral_stats() does for float spectra.
+ *
+ * The entropy uses the same identity: with p = a / total,
+ *   -sum(p * log2(p)) = log2(total) - sum(a * log2(a)) / total
+ * with the logarithms taken by ilog2_q16(), so it only costs two divisions
+ * per call. Empty bins do not contribute, and a silent range has an entropy
+ * of 0. The normalized entropy is within 7e-5 of the float one.
+ *
+ * @param currWindow The current input spectrum data
+ * @param prevWindow The previous input spectrum data, may be NULL
+ * @param lowerBin The lower bin bound to analyze
+ * @param upperBin The upper bin bound to analyze (exclusive)
+ * @param stats Output, the calculated statistics
+ * @param withEntropy Whether to calculate the entropy
+ */
+inline void spectral_stats_q15(const q15_t* currWindow, const q15_t* prevWindow,
+    int lowerBin, int upperBin, SpectralStatsQ15& stats, bool withEntropy = false)
+{
+    uint64_t info = 0;
+    if (prevWindow != NULL) {
+        if (withEntropy) {
+            spectral_stats_q15_pass<true, true>(currWindow, prevWindow, lowerBin, upperBin, stats, info);
+        } else {
+            spectral_stats_q15_pass<true, false>(currWindow, prevWindow, lowerBin, upperBin, stats, info);
+        }
+    } else {
+        if (withEntropy) {
+            spectral_stats_q15_pass<false, true>(currWindow, prevWindow, lowerBin, upperBin, stats, info);
+        } else {
+            spectral_stats_q15_pass<false, false>(currWindow, prevWindow, lowerBin, upperBin, stats, info);
+        }
+    }
+
+    stats.entropy = 0;
+    int numBins   = upperBin - lowerBin;
+    if (withEntropy && stats.sum > 0 && numBins > 1) {
+        // entropy in Q16, sum(a * log2(a)) was accumulated in Q11
+        int64_t entropy = (int64_t)ilog2_q16(stats.sum) - (int64_t)((info << 5) / stats.sum);
+        if (entropy < 0) {
+            entropy = 0;
+        }
+
+        // normalize the entropy value by the log2 of the number of bins, which
+        // is the maximum possible entropy value.
+        int64_t normalized = ((uint64_t)entropy << 15) / ilog2_q16(numBins);
+        stats.entropy      = normalized > Q15_MAX ? Q15_MAX : (q15_t)normalized;
+    }
+}
+
+} // AudioPrism
+
+#endif // FIXED_POINT_H
@@ -17,7 +17,13 @@ void ModuleGroup::addModule(AnalysisModule* module)
     module->setSpectrogram(this->spectrogram);
     module->setAnalysisRangeByFreq(this->lowerFreq, this->upperFreq);
 
+    module->setLazy(this->lazy);
+
     this->modules.push_back(module);
+    this->sharingUpdated = false;
+#ifndef ARDUINO
+    this->tasks.push_back({ &ModuleGroup::analyzeModule, module });
+#endif
 }
 
 void ModuleGroup::addModule(AnalysisModule* module, int lowerFreq, int upperFreq)
@@ -25,12 +31,194 @@ void ModuleGroup::addModule(AnalysisModule* module, int lowerFreq, int upperFreq
     module->setSpectrogram(this->spectrogram);
     module->setAnalysisRangeByFreq(lowerFreq, upperFreq);
 
+    module->setLazy(this->lazy);
+
     this->modules.push_back(module);
+    this->sharingUpdated = false;
+#ifndef ARDUINO
+    this->tasks.push_back({ &ModuleGroup::analyzeModule, module });
+#endif
+}
+
+void ModuleGroup::collectModules(AnalysisModule* module, std::vector<AnalysisModule*>& nodes)
+{
+    for (AnalysisModule* submodule : module->submodules) {
+        collectModules(submodule, nodes);
+    }
+    nodes.push_back(module);
+}
+
+void ModuleGroup::updateSharing()
+{
+    this->sharingVersion = AnalysisModule::parameterVersion;
+    this->sharingUpdated = true;
+
+    // every module of the group, in dependency order
+    std::vector<AnalysisModule*> nodes;
+    for (AnalysisModule* module : this->modules) {
+        collectModules(module, nodes);
+    }
+
+    for (AnalysisModule* node : nodes) {
+        node->source   = NULL;
+        node->shared   = false;
+        node->analyzed = false;
+    }
+
+    this->sharedModules.clear();
+    if (!this->sharing) {
+        return;
+    }
+
+    // link each module to the first equivalent module found before it, which
+    // is analyzed instead
+    std::vector<AnalysisModule*> unique;
+    for (AnalysisModule* node : nodes) {
+        for (AnalysisModule* other : unique) {
+            if (node == other || node->isEquivalent(other)) {
+                if (node != other) {
+                    node->source = other;
+                }
+                other->shared = true;
+                break;
+            }
+        }
+        if (node->source == NULL && !node->shared) {
+            unique.push_back(node);
+        }
+    }
+
+    for (AnalysisModule* node : unique) {
+        if (node->shared) {
+            this->sharedModules.push_back(node);
+        }
+    }
+}
+
+void ModuleGroup::setSharing(bool sharing)
+{
+    this->sharing        = sharing;
+    this->sharingUpdated = false;
+}
+
+void ModuleGroup::setLazy(bool lazy)
+{
+    this->lazy = lazy;
+    for (AnalysisModule* module : this->modules) {
+        module->setLazy(lazy);
+    }
 }
 
 void ModuleGroup::runAnalysis()
 {
+    if (this->sharingOutdated()) {
+        this->updateSharing();
+    }
+
+#ifndef ARDUINO
+    if (this->pool != NULL) {
+        this->dispatchAnalysis();
+        this->pool->wait();
+        return;
+    }
+#endif
+
+    // lazy modules are analyzed when their output is read
+    for (AnalysisModule* module : this->modules) {
+        if (!module->lazy) {
+            module->analyze();
+        }
+    }
+}
+
+int ModuleGroup::getNumFeatures()
+{
+    int numFeatures = 0;
     for (AnalysisModule* module : this->modules) {
-        module->doAnalysis();
+        numFeatures += module->getNumFeatures();
+    }
+    return numFeatures;
+}
+
+void ModuleGroup::analyzeBatch(const float* frames, int numFrames, float* features, int stride)
+{
+    if (this->spectrogram == NULL) {
+        Serial.printf("Error: analyzeBatch() requires a spectrogram.\n");
+        return;
+    }
+    if (this->spectrogram->isShared()) {
+        Serial.printf("Error: analyzeBatch() cannot push windows to a SharedSpectrogram.\n");
+        return;
+    }
+    if (stride <= 0) {
+        stride = numFrames;
+    }
+
+    // each module fills the rows after those of the modules before it, the
+    // offsets are computed once for the batch. Debug output is disabled
+    // during the batch, and restored afterwards.
+    int numModules = this->modules.size();
+    this->batchOffsets.resize(numModules);
+    this->batchDebugModes.resize(numModules);
+    int numFeatures = 0;
+    for (int i = 0; i < numModules; i++) {
+        AnalysisModule* module = this->modules[i];
+        this->batchOffsets[i]    = numFeatures * stride;
+        this->batchDebugModes[i] = module->debugMode;
+        numFeatures += module->getNumFeatures();
+        module->setDebugMode(0);
+    }
+
+    int numBins = this->spectrogram->getNumBins();
+    for (int frame = 0; frame < numFrames; frame++) {
+        this->spectrogram->pushWindow(frames + frame * numBins);
+        this->runAnalysis();
+
+        for (int i = 0; i < numModules; i++) {
+            this->modules[i]->storeFeatures(features + frame + this->batchOffsets[i], stride);
+        }
+    }
+
+    for (int i = 0; i < numModules; i++) {
+        this->modules[i]->setDebugMode(this->batchDebugModes[i]);
+    }
+}
+
+#ifndef ARDUINO
+void ModuleGroup::dispatchAnalysis()
+{
+    if (this->pool == NULL) {
+        // no pool to queue on, run in place
+        this->runAnalysis();
+        return;
+    }
+    if (this->sharingOutdated()) {
+        this->updateSharing();
+    }
+
+    // nothing to run if every module is lazy
+    bool eager = false;
+    for (AnalysisModule* module : this->modules) {
+        eager = eager || !module->lazy;
+    }
+    if (!eager) {
+        return;
+    }
+
+    // shared modules run first, so the parallel modules using them only read
+    // their results
+    for (AnalysisModule* module : this->sharedModules) {
+        module->analyze();
+    }
+
+    this->pool->submit(this->tasks.data(), this->tasks.size());
+}
+
+void ModuleGroup::analyzeModule(void* module)
+{
+    AnalysisModule* analysisModule = (AnalysisModule*)module;
+    if (!analysisModule->lazy) {
+        analysisModule->analyze();
     }
 }
+#endif
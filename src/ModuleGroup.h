@@ -9,6 +9,7 @@
 #include <vector>
 #include "AnalysisModule.h"
 #include "Spectrogram.h"
+#include "ThreadPool.h"
 
 class ModuleGroup {
 public:
@@ -77,18 +78,156 @@ public:
     void addModule(AnalysisModule* module, Spectrogram* spectrogram,
         int lowerFreq, int upperFreq);
 
+    /**
+     * Find the modules in the group, including submodules at any depth, that
+     * are equivalent (same type, spectrogram, analysis range and parameters).
+     *
+     * Each set of equivalent modules is then analyzed only once per frame,
+     * before the modules that depend on it, and the others return its
+     * output. E.g. a MajorPeaks(5) added next to a Formants module shares the
+     * peaks found by the MajorPeaks(5) inside Formants.
+     *
+     * Called automatically by runAnalysis() when a module was added, or the
+     * audio context, analysis range or parameters of any module changed
+     * since the links were built (see AnalysisModule::parametersChanged()).
+     *
+     * A module sharing the results of another one does not run its own
+     * analysis: it prints no debug output, and only its getOutput() follows
+     * the frame, not other public members it updates in doAnalysis().
+     */
+    void updateSharing();
+
+    /**
+     * Enable or disable sharing results between equivalent modules, enabled
+     * by default. Without sharing, every module runs its own analysis.
+     *
+     * @param sharing Whether equivalent modules of the group share results.
+     */
+    void setSharing(bool sharing);
+
+    /**
+     * Set all modules of the group, and modules added later, to lazy mode.
+     *
+     * runAnalysis() then skips them: each module is analyzed by the first
+     * read of its output in a frame, see AnalysisModule::setLazy(). Q15
+     * modules cannot be lazy and are still run by runAnalysis().
+     *
+     * @param lazy Whether the modules of the group are lazy.
+     */
+    void setLazy(bool lazy);
+
     /**
      * Run the analysis function for all modules in the group.
+     *
+     * If the group has a thread pool, modules run in parallel, and this
+     * returns once all of them have finished.
      */
     void runAnalysis();
 
+    /**
+     * Get the number of features stored per frame by analyzeBatch(), the sum
+     * of the features of each module in the group.
+     *
+     * @return The number of rows of the group's feature matrix.
+     */
+    int getNumFeatures();
+
+    /**
+     * Analyze a block of consecutive frames and store the outputs of all
+     * modules in a columnar feature matrix.
+     *
+     * Each frame is pushed to the group's spectrogram and analyzed as by
+     * runAnalysis(), so the first frame follows the current window of the
+     * spectrogram and consecutive blocks give the same outputs as a
+     * per-frame loop. The features of each module (see
+     * AnalysisModule::getNumFeatures()) are stored in the order the modules
+     * were added: feature i of frame f is written to features[i * stride + f].
+     *
+     * This is a convenience over the per-frame loop, not a separate analysis
+     * path: each frame is still copied into the spectrogram, whose earlier
+     * windows, feature cache and prefix sums the modules read. Only the
+     * feature offsets are computed once per batch, and debug output is
+     * disabled during the batch. A SharedSpectrogram is refused, its windows
+     * are pushed by its producer.
+     *
+     * Ex. float* features = new float[group.getNumFeatures() * numFrames];
+     *     group.analyzeBatch(frames, numFrames, features);
+     *
+     * @param frames numFrames windows of the spectrogram's size, contiguous.
+     * @param numFrames The number of frames to analyze.
+     * @param features The feature matrix, one column of stride floats per
+     *                 feature.
+     * @param stride The length of a column, numFrames if 0. Larger strides
+     *               fill part of the columns of a matrix covering several
+     *               blocks, from the column offset of the first frame.
+     */
+    void analyzeBatch(const float* frames, int numFrames, float* features, int stride = 0);
+
+#ifndef ARDUINO
+    /**
+     * Run the modules of the group on a thread pool.
+     *
+     * Modules only read the Spectrogram and write their own output, so each
+     * module is an independent task; outputs are the same as a serial run.
+     * Debug output of parallel modules may interleave in any order. Shared
+     * modules (see updateSharing()) are analyzed first, on the calling
+     * thread. A module must only be added to one group.
+     *
+     * @param pool The pool to run on, NULL to run serially again.
+     */
+    void setThreadPool(ThreadPool* pool) { this->pool = pool; };
+
+    /**
+     * Queue the analysis of all modules in the group on its thread pool
+     * without waiting for it.
+     *
+     * Used to run several independent groups in parallel: dispatch each one,
+     * then call wait() on the pool.
+     * Ex. lows.dispatchAnalysis();
+     *     highs.dispatchAnalysis();
+     *     pool.wait();
+     */
+    void dispatchAnalysis();
+#endif
+
 private:
     int lowerFreq = 0;
     int upperFreq = SAMPLE_RATE >> 1;
 
     Spectrogram* spectrogram;
 
+    bool lazy = false;
+
     std::vector<AnalysisModule*> modules;
+
+    // modules whose results are shared, submodules before their parents
+    std::vector<AnalysisModule*> sharedModules;
+    bool                         sharing        = true;
+    bool                         sharingUpdated = false;
+    uint32_t                     sharingVersion = 0; // AnalysisModule::parameterVersion of the links
+
+    // whether modules were added or changed since updateSharing()
+    bool sharingOutdated() const
+    {
+        return !this->sharingUpdated || this->sharingVersion != AnalysisModule::parameterVersion;
+    }
+
+    // appends the module and its submodules to nodes, submodules first
+    static void collectModules(AnalysisModule* module, std::vector<AnalysisModule*>& nodes);
+
+    // per module feature row offsets (times the stride) and saved debug
+    // modes of analyzeBatch(), kept to not allocate on every batch
+    std::vector<int> batchOffsets;
+    std::vector<int> batchDebugModes;
+
+#ifndef ARDUINO
+    ThreadPool* pool = NULL;
+
+    // one task per module, to submit without rebuilding them every frame
+    std::vector<ThreadPool::Task> tasks;
+
+    static void analyzeModule(void* module);
+#endif
 };
 
 #endif // MODULE_GROUP_H
@@ -0,0 +1,66 @@
+#include "Platform.h"
+
+#ifndef ARDUINO
+
+HostSerial Serial;
+
+HostSerial::HostSerial()
+{
+    this->sink = stdout;
+}
+
+void HostSerial::setSink(FILE* sink)
+{
+    this->sink = sink;
+}
+
+int HostSerial::printf(const char* format, ...)
+{
+    if (this->sink == NULL) {
+        return 0;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int written = vfprintf(this->sink, format, args);
+    va_end(args);
+
+    return written;
+}
+
+int HostSerial::print(const char* str)
+{
+    return this->printf("%s", str);
+}
+
+int HostSerial::print(float value)
+{
+    return this->printf("%.2f", value);
+}
+
+int HostSerial::print(int value)
+{
+    return this->printf("%d", value);
+}
+
+int HostSerial::println()
+{
+    return this->printf("\n");
+}
+
+int HostSerial::println(const char* str)
+{
+    return this->printf("%s\n", str);
+}
+
+int HostSerial::println(float value)
+{
+    return this->printf("%.2f\n", value);
+}
+
+int HostSerial::println(int value)
+{
+    return this->printf("%d\n", value);
+}
+
+#endif // ARDUINO
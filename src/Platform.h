@@ -0,0 +1,69 @@
+/*
+ * @file
+ * Contains the platform abstraction layer used by AudioPrism.
+ *
+ * On Arduino targets this simply pulls in the Arduino core. On any other
+ * target (e.g. a Linux host) it provides the small subset of the Arduino API
+ * that AudioPrism relies on: a Serial logging sink and the min helper, so
+ * the same module code compiles unmodified off-device. abs and round come
+ * from the C library headers included below.
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+
+#else // host build
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Stand-in for Arduino's HardwareSerial when building for a host.
+ *
+ * All output is written to a stdio stream, stdout by default. The sink can be
+ * redirected to any open FILE* (e.g. stderr or a log file), or set to NULL to
+ * silence debug output entirely when batch-processing.
+ */
+class HostSerial {
+public:
+    HostSerial();
+
+    // redirect all output to the given stream, NULL discards output
+    void setSink(FILE* sink);
+
+    FILE* getSink() const { return this->sink; };
+
+    void begin(unsigned long baud) { (void)baud; };
+
+    int printf(const char* format, ...);
+
+    int print(const char* str);
+    int print(float value);
+    int print(int value);
+
+    int println();
+    int println(const char* str);
+    int println(float value);
+    int println(int value);
+
+    explicit operator bool() const { return true; };
+
+private:
+    FILE* sink;
+};
+
+extern HostSerial Serial;
+
+// Arduino provides min as a macro, provide a type-safe equivalent
+template <typename T>
+inline T min(T a, T b) { return (b < a) ? b : a; }
+
+#endif // ARDUINO
+
+#endif // PLATFORM_H
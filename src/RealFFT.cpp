@@ -0,0 +1,127 @@
+#include "RealFFT.h"
+
+RealFFT::RealFFT(WindowFunction windowFunction)
+{
+    init(WINDOW_SIZE, windowFunction);
+}
+
+RealFFT::RealFFT(int windowSize, WindowFunction windowFunction)
+{
+    init(windowSize, windowFunction);
+}
+
+RealFFT::~RealFFT()
+{
+    delete[] this->window;
+    delete[] this->cosTable;
+    delete[] this->sinTable;
+    delete[] this->bitReverse;
+    delete[] this->real;
+    delete[] this->imag;
+}
+
+void RealFFT::init(int windowSize, WindowFunction windowFunction)
+{
+    // window size must be a power of 2 for the radix-2 FFT, and the packed
+    // complex FFT needs at least 2 points
+    if (windowSize < 4 || (windowSize & (windowSize - 1)) != 0) {
+        Serial.printf("Error: FFT window size must be a power of 2, 4 or more.\n");
+        windowSize = WINDOW_SIZE;
+    }
+
+    this->windowSize = windowSize;
+    this->numPoints  = windowSize >> 1;
+    this->dcRemoval  = false;
+
+    this->window     = new float[windowSize];
+    this->cosTable   = new float[this->numPoints];
+    this->sinTable   = new float[this->numPoints];
+    this->bitReverse = new uint16_t[this->numPoints];
+    this->real       = new float[this->numPoints];
+    this->imag       = new float[this->numPoints];
+
+    for (int k = 0; k < this->numPoints; k++) {
+        double angle      = 2.0 * M_PI * k / windowSize;
+        this->cosTable[k] = cos(angle);
+        this->sinTable[k] = sin(angle);
+    }
+
+    int numBits = 0;
+    while ((1 << numBits) < this->numPoints) {
+        numBits++;
+    }
+    for (int k = 0; k < this->numPoints; k++) {
+        int reversed = 0;
+        for (int b = 0; b < numBits; b++) {
+            reversed |= ((k >> b) & 1) << (numBits - 1 - b);
+        }
+        this->bitReverse[k] = reversed;
+    }
+
+    setWindowFunction(windowFunction);
+}
+
+void RealFFT::setWindowFunction(WindowFunction windowFunction)
+{
+    for (int i = 0; i < this->windowSize; i++) {
+        double ratio = double(i) / (this->windowSize - 1);
+        switch (windowFunction) {
+        case WINDOW_HAMMING:
+            this->window[i] = 0.54 - 0.46 * cos(2.0 * M_PI * ratio);
+            break;
+        case WINDOW_HANN:
+            this->window[i] = 0.5 * (1.0 - cos(2.0 * M_PI * ratio));
+            break;
+        default:
+            this->window[i] = 1.0;
+            break;
+        }
+    }
+}
+
+void RealFFT::transform(float* magnitudes)
+{
+    float* re = this->real;
+    float* im = this->imag;
+    int    n  = this->numPoints;
+
+    // radix-2 butterflies over the bit-reversed points, the twiddle factor of
+    // a stage of length len is exp(-2 pi i k / len), every (windowSize / len)th
+    // entry of the table
+    for (int len = 2; len <= n; len <<= 1) {
+        int halfLen = len >> 1;
+        int stride  = this->windowSize / len;
+        for (int k = 0; k < halfLen; k++) {
+            float wr = this->cosTable[k * stride];
+            float wi = -this->sinTable[k * stride];
+            for (int i = k; i < n; i += len) {
+                int   j  = i + halfLen;
+                float xr = re[j] * wr - im[j] * wi;
+                float xi = re[j] * wi + im[j] * wr;
+                re[j]    = re[i] - xr;
+                im[j]    = im[i] - xi;
+                re[i] += xr;
+                im[i] += xi;
+            }
+        }
+    }
+
+    // split the result Z into the spectrum X of the real input:
+    //   E[k] = (Z[k] + conj(Z[n-k])) / 2      spectrum of the even samples
+    //   O[k] = (Z[k] - conj(Z[n-k])) / 2i     spectrum of the odd samples
+    //   X[k] = E[k] + exp(-2 pi i k / windowSize) O[k]
+    for (int k = 0; k < n; k++) {
+        int   m     = (n - k) & (n - 1);
+        float evenR = 0.5 * (re[k] + re[m]);
+        float evenI = 0.5 * (im[k] - im[m]);
+        float oddR  = 0.5 * (im[k] + im[m]);
+        float oddI  = -0.5 * (re[k] - re[m]);
+
+        float c  = this->cosTable[k];
+        float s  = this->sinTable[k];
+        float xr = evenR + c * oddR + s * oddI;
+        float xi = evenI + c * oddI - s * oddR;
+
+        magnitudes[k] = sqrt(xr * xr + xi * xi);
+    }
+}
@@ -0,0 +1,149 @@
+/*
+ * @file
+ * Contains the RealFFT class definition.
+ */
+
+#ifndef REAL_FFT_H
+#define REAL_FFT_H
+
+#include <stdint.h>
+
+#include "Config.h"
+#include "Platform.h"
+
+/**
+ * Window functions applied to the samples before the transform.
+ *
+ * Hamming and Hann windows are symmetric, as in ArduinoFFT.
+ */
+enum WindowFunction {
+    WINDOW_RECTANGULAR,
+    WINDOW_HAMMING,
+    WINDOW_HANN
+};
+
+/**
+ * RealFFT turns windows of real samples into the magnitude spectra analyzed
+ * by AudioPrism modules.
+ *
+ * The N real samples are packed into an N/2 point complex FFT (even samples
+ * in the real parts, odd samples in the imaginary parts), whose result is
+ * split into the spectrum of the real input, which takes about half the work
+ * of a complex FFT of real input. The window function, the twiddle factors
+ * and the bit-reversal permutation are computed once, when the RealFFT is
+ * created, and windowing is fused with loading the samples.
+ *
+ * Magnitudes are not normalized, as with ArduinoFFT's complexToMagnitude(),
+ * and bins 0 to N/2 - 1 are written. They can be written straight into the
+ * next window of a Spectrogram with pushWindow().
+ *
+ * Ex. RealFFT fft = RealFFT(WINDOW_HAMMING);
+ *     fft.pushWindow(samples, &spectrogram);
+ *     group.runAnalysis();
+ */
+class RealFFT {
+public:
+    /**
+     * Create a RealFFT for windows of WINDOW_SIZE samples.
+     *
+     * @param windowFunction The window function to apply to the samples.
+     */
+    RealFFT(WindowFunction windowFunction = WINDOW_HAMMING);
+
+    /**
+     * Create a RealFFT for windows of windowSize samples.
+     *
+     * @param windowSize The number of samples in a window, a power of 2, 4 or more.
+     * @param windowFunction The window function to apply to the samples.
+     */
+    RealFFT(int windowSize, WindowFunction windowFunction = WINDOW_HAMMING);
+
+    ~RealFFT();
+
+    /**
+     * Change the window function, recomputing its table.
+     */
+    void setWindowFunction(WindowFunction windowFunction);
+
+    /**
+     * Subtract the mean of each window from its samples before windowing,
+     * like ArduinoFFT's dcRemoval(). Disabled by default.
+     */
+    void setDCRemoval(bool dcRemoval) { this->dcRemoval = dcRemoval; };
+
+    int getWindowSize() const { return this->windowSize; };
+
+    /**
+     * Compute the magnitude spectrum of a window of samples.
+     *
+     * @param samples windowSize samples, of any arithmetic type, e.g. the int
+     *                samples of an ADC buffer.
+     * @param magnitudes The windowSize / 2 magnitudes of the spectrum.
+     */
+    template <typename T>
+    void compute(const T* samples, float* magnitudes);
+
+    /**
+     * Compute the magnitude spectrum of a window of samples directly into the
+     * next window of a Spectrogram (or SharedSpectrogram), and commit it.
+     *
+     * @param samples windowSize samples.
+     * @param spectrogram The spectrogram, with windowSize / 2 bins per window.
+     */
+    template <typename T, class SpectrogramType>
+    void pushWindow(const T* samples, SpectrogramType* spectrogram)
+    {
+        this->compute(samples, spectrogram->acquireWindow());
+        spectrogram->commitWindow();
+    }
+
+private:
+    int windowSize;
+    int numPoints; // size of the complex FFT, windowSize / 2
+
+    bool dcRemoval;
+
+    // window function, windowSize values
+    float* window;
+
+    // exp(-2 pi i k / windowSize) for k < numPoints, the complex FFT uses
+    // every other factor
+    float* cosTable;
+    float* sinTable;
+
+    // bit-reversed index of each point of the complex FFT
+    uint16_t* bitReverse;
+
+    // complex FFT data, in place
+    float* real;
+    float* imag;
+
+    void init(int windowSize, WindowFunction windowFunction);
+
+    // runs the complex FFT on the loaded points and splits its result into
+    // the magnitudes of the real spectrum
+    void transform(float* magnitudes);
+};
+
+template <typename T>
+void RealFFT::compute(const T* samples, float* magnitudes)
+{
+    float mean = 0.0;
+    if (this->dcRemoval) {
+        for (int i = 0; i < this->windowSize; i++) {
+            mean += samples[i];
+        }
+        mean /= this->windowSize;
+    }
+
+    // load pairs of windowed samples as complex points, in bit-reversed order
+    for (int k = 0; k < this->numPoints; k++) {
+        int j         = this->bitReverse[k];
+        this->real[j] = (float(samples[2 * k]) - mean) * this->window[2 * k];
+        this->imag[j] = (float(samples[2 * k + 1]) - mean) * this->window[2 * k + 1];
+    }
+
+    this->transform(magnitudes);
+}
+
+#endif // REAL_FFT_H
@@ -0,0 +1,34 @@
+#include "STFT.h"
+
+STFT::STFT(int hopSize, WindowFunction windowFunction)
+    : fft(WINDOW_SIZE, windowFunction)
+{
+    if (hopSize < 1 || hopSize > WINDOW_SIZE) {
+        Serial.printf("Error: hop size must be between 1 and WINDOW_SIZE.\n");
+        hopSize = WINDOW_SIZE;
+    }
+    this->hopSize = hopSize;
+    this->ring    = new float[2 * RING_SIZE];
+    reset();
+}
+
+STFT::~STFT()
+{
+    delete[] this->ring;
+}
+
+bool STFT::nextFrame(float* magnitudes)
+{
+    if (this->getNumBuffered() < WINDOW_SIZE) {
+        return false;
+    }
+    this->fft.compute(this->ring + (this->frameStart & RING_MASK), magnitudes);
+    this->frameStart += this->hopSize;
+    return true;
+}
+
+void STFT::reset()
+{
+    this->numWritten = 0;
+    this->frameStart = 0;
+}
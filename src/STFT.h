@@ -0,0 +1,141 @@
+/*
+ * @file
+ * Contains the STFT class definition.
+ */
+
+#ifndef STFT_H
+#define STFT_H
+
+#include <stdint.h>
+
+#include "Config.h"
+#include "RealFFT.h"
+
+/**
+ * STFT turns a stream of samples into overlapping windows of magnitudes.
+ *
+ * Samples are appended to an input ring in blocks of any size, and a window
+ * of WINDOW_SIZE samples is transformed every hopSize samples. A hop size
+ * smaller than WINDOW_SIZE updates the analysis more often (e.g. 4x with a
+ * quarter window hop) without shrinking the window and losing frequency
+ * resolution. The first window is transformed once WINDOW_SIZE samples have
+ * been added.
+ *
+ * Set the hop size of the Spectrogram receiving the windows as well (see
+ * Spectrogram::setHopSize()), so modules comparing windows over time take
+ * the overlap into account.
+ *
+ * Ex. STFT stft = STFT(WINDOW_SIZE / 4);
+ *     Spectrogram spectrogram = Spectrogram(5);
+ *     spectrogram.setHopSize(stft.getHopSize());
+ *
+ *     stft.addSamples(AudioLabInputBuffer, WINDOW_SIZE);
+ *     while (stft.pushFrame(&spectrogram)) {
+ *         group.runAnalysis();
+ *     }
+ */
+class STFT {
+public:
+    /**
+     * Create an STFT emitting a window every hopSize samples.
+     *
+     * @param hopSize The number of samples between windows, 1 to WINDOW_SIZE.
+     * @param windowFunction The window function applied to each window.
+     */
+    STFT(int hopSize = WINDOW_SIZE, WindowFunction windowFunction = WINDOW_HAMMING);
+
+    ~STFT();
+
+    int getHopSize() const { return this->hopSize; };
+
+    /**
+     * Gets the FFT transforming the windows, e.g. to enable DC removal.
+     */
+    RealFFT* getFFT() { return &this->fft; };
+
+    /**
+     * Gets the number of buffered samples not yet covered by a transformed
+     * window, at most 2 * WINDOW_SIZE.
+     */
+    int getNumBuffered() const { return int(this->numWritten - this->frameStart); };
+
+    /**
+     * Append samples to the input ring.
+     *
+     * The ring holds 2 * WINDOW_SIZE samples, so blocks of up to WINDOW_SIZE
+     * samples are always accepted if the available windows are transformed
+     * between blocks.
+     *
+     * @param samples The samples, of any arithmetic type.
+     * @param numSamples The number of samples.
+     * @return The number of samples appended, fewer than numSamples if the
+     *         ring is full.
+     */
+    template <typename T>
+    int addSamples(const T* samples, int numSamples);
+
+    /**
+     * Transform the next window, if all of its samples have been added.
+     *
+     * @param magnitudes The WINDOW_SIZE / 2 magnitudes of the window.
+     * @return Whether a window was transformed.
+     */
+    bool nextFrame(float* magnitudes);
+
+    /**
+     * Transform the next window, if all of its samples have been added,
+     * directly into the next window of a Spectrogram (or SharedSpectrogram).
+     *
+     * @param spectrogram The spectrogram to push the window to.
+     * @return Whether a window was pushed.
+     */
+    template <class SpectrogramType>
+    bool pushFrame(SpectrogramType* spectrogram)
+    {
+        if (this->getNumBuffered() < WINDOW_SIZE) {
+            return false;
+        }
+        this->fft.pushWindow(this->ring + (this->frameStart & RING_MASK), spectrogram);
+        this->frameStart += this->hopSize;
+        return true;
+    }
+
+    /**
+     * Discard all buffered samples.
+     */
+    void reset();
+
+private:
+    static const int RING_SIZE = 2 * WINDOW_SIZE;
+    static const int RING_MASK = RING_SIZE - 1;
+
+    RealFFT fft;
+    int     hopSize;
+
+    // every sample is stored twice, RING_SIZE samples apart, so the window
+    // starting at any position of the ring is contiguous
+    float* ring;
+
+    // samples added since the last reset, and the first sample of the next window
+    uint32_t numWritten;
+    uint32_t frameStart;
+};
+
+template <typename T>
+int STFT::addSamples(const T* samples, int numSamples)
+{
+    int space = RING_SIZE - this->getNumBuffered();
+    if (numSamples > space) {
+        numSamples = space;
+    }
+
+    for (int i = 0; i < numSamples; i++) {
+        int index                     = (this->numWritten + i) & RING_MASK;
+        this->ring[index]             = float(samples[i]);
+        this->ring[index + RING_SIZE] = float(samples[i]);
+    }
+    this->numWritten += numSamples;
+    return numSamples;
+}
+
+#endif // STFT_H
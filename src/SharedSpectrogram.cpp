@@ -0,0 +1,111 @@
+#include "SharedSpectrogram.h"
+
+SharedSpectrogram::SharedSpectrogram(const uint16_t numWindows, const bool mirrored)
+    : Spectrogram(numWindows, mirrored)
+{
+    this->init();
+}
+
+SharedSpectrogram::SharedSpectrogram(float* buffer, const uint16_t numWindows, const bool mirrored)
+    : Spectrogram(buffer, numWindows, mirrored)
+{
+    this->init();
+}
+
+void SharedSpectrogram::init()
+{
+    this->writeIndex        = this->currIndex;
+    this->writeHistoryIndex = this->historyIndex;
+    this->writeFrame.store(this->frameCount, std::memory_order_relaxed);
+    this->publishedFrame.store(this->frameCount, std::memory_order_relaxed);
+    this->droppedFrames = 0;
+    this->shared        = true;
+}
+
+float* SharedSpectrogram::acquireWindow()
+{
+    // mark the frame as being written before touching its slot, the fence
+    // orders the mark before the window data for a consumer checking
+    // isOverrun() after reading the slot
+    uint32_t nextFrame = this->publishedFrame.load(std::memory_order_relaxed) + 1;
+    this->writeFrame.store(nextFrame, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint16_t next_index = (this->writeIndex + 1) % this->numWindows;
+    return this->buffer + (next_index * this->numBins);
+}
+
+void SharedSpectrogram::commitWindow()
+{
+    this->writeIndex++;
+    if (this->writeIndex == this->numWindows) {
+        this->writeIndex = 0;
+    }
+
+    // keep the mirror in sync before publishing the window
+    if (this->mirrored) {
+        float* windowBuffer = this->buffer + (this->writeIndex * this->numBins);
+        memcpy(windowBuffer + (this->numWindows * this->numBins), windowBuffer,
+            this->numBins * sizeof(float));
+    }
+
+    // the prefix-sum rows are published along with the window
+    if (this->prefixSums != NULL) {
+        indexWindow(this->writeIndex);
+    }
+
+    // as is its compressed copy
+    if (this->history != NULL) {
+        this->writeHistoryIndex = (this->writeHistoryIndex + 1) % this->historyLength;
+        compressWindow(this->writeHistoryIndex, this->buffer + (this->writeIndex * this->numBins));
+    }
+
+    // release the window data along with its sequence number
+    uint32_t frame = this->writeFrame.load(std::memory_order_relaxed);
+    this->publishedFrame.store(frame, std::memory_order_release);
+}
+
+void SharedSpectrogram::pushWindow(const float* data)
+{
+    memcpy(this->acquireWindow(), data, this->numBins * sizeof(float));
+    this->commitWindow();
+}
+
+void SharedSpectrogram::clearBuffer()
+{
+    Spectrogram::clearBuffer();
+    this->init();
+}
+
+uint32_t SharedSpectrogram::update()
+{
+    uint32_t published = this->publishedFrame.load(std::memory_order_acquire);
+    uint32_t advanced  = published - this->frameCount;
+    if (advanced == 0) {
+        return 0;
+    }
+    this->droppedFrames += advanced - 1;
+
+    // the published window is the one the producer last wrote, the
+    // difference in frames gives its slot even across counter overflow
+    this->currIndex  = (this->currIndex + advanced % this->numWindows) % this->numWindows;
+    this->frameCount = published;
+    if (this->history != NULL) {
+        this->historyIndex = (this->historyIndex + advanced % this->historyLength) % this->historyLength;
+    }
+    return advanced;
+}
+
+bool SharedSpectrogram::isOverrun(const uint16_t depth) const
+{
+    // pairs with the fence in acquireWindow(): if analysis read any data the
+    // producer wrote, the frame marking that write is visible here
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t ahead = this->writeFrame.load(std::memory_order_relaxed) - this->frameCount;
+    uint32_t reads = depth == 0 ? this->hopLag + 1 : depth;
+
+    // writing frame frameCount + k overwrites the slot of frame
+    // frameCount + k - numWindows, which analysis reads if it is one of the
+    // reads most recent frames
+    return ahead + reads > this->numWindows;
+}
@@ -0,0 +1,134 @@
+/*
+ * @file
+ * Contains the SharedSpectrogram class definition.
+ */
+
+#ifndef SHARED_SPECTROGRAM_H
+#define SHARED_SPECTROGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "Spectrogram.h"
+
+/**
+ * A Spectrogram shared by one producer and one consumer thread.
+ *
+ * The producer (e.g. capture and FFT on one core) writes windows with
+ * acquireWindow() and commitWindow(), or pushWindow(). Each committed window
+ * is published with a sequence number, the frame count, without locks. The
+ * consumer (e.g. a ModuleGroup running on another core) calls update() to
+ * adopt the latest published window as the current one, then analyzes it
+ * through the usual Spectrogram getters, which only ever change in update().
+ *
+ * The producer never waits for the consumer. If it runs too far ahead, it
+ * overwrites windows the consumer is still reading; the consumer detects this
+ * after its analysis with isOverrun() and should discard the results. Modules
+ * read the current window and the non-overlapping one, hopLag windows back
+ * (1 unless a hop size smaller than WINDOW_SIZE is set, see setHopSize()), so
+ * the producer can commit up to numWindows - hopLag - 1 windows during one
+ * analysis without overrun.
+ * The same holds for the compressed history (see enableCompressedHistory()),
+ * whose oldest windows the producer overwrites while it runs ahead.
+ *
+ * Every other Spectrogram member belongs to the consumer. Only use this class through a Spectrogram pointer on the consumer
+ * side: the producer methods hide the unsynchronized ones of Spectrogram.
+ */
+class SharedSpectrogram : public Spectrogram {
+public:
+    /**
+     * Creates a SharedSpectrogram with a buffer to hold data.
+     *
+     * @param numWindows The number of time windows the Spectrogram holds.
+     * @param mirrored Whether to keep the windows contiguous, see getHistory().
+     */
+    SharedSpectrogram(const uint16_t numWindows, const bool mirrored = false);
+
+    /**
+     * Creates a SharedSpectrogram over a buffer owned by the user.
+     *
+     * @param buffer The buffer to hold the windows, see Spectrogram.
+     * @param numWindows The number of time windows the Spectrogram holds.
+     * @param mirrored Whether to keep the windows contiguous, see getHistory().
+     */
+    SharedSpectrogram(float* buffer, const uint16_t numWindows, const bool mirrored = false);
+
+    //========================================================================
+    // Producer
+    //========================================================================
+
+    /**
+     * Gets the slot the next window will be written to.
+     *
+     * Marks the next frame as being written, so a consumer still reading the
+     * slot can detect the overrun.
+     *
+     * @return Array of WINDOW_SIZE / 2 bins to write frequency domain data to
+     */
+    float* acquireWindow();
+
+    /**
+     * Publishes the slot returned by acquireWindow() to the consumer.
+     */
+    void commitWindow();
+
+    /**
+     * Copies a window to the next slot and publishes it.
+     *
+     * @param data Pointer to the window's frequency domain data.
+     */
+    void pushWindow(const float* data);
+
+    //========================================================================
+    // Consumer
+    //========================================================================
+
+    /**
+     * Makes the latest published window the current one.
+     *
+     * @return The number of windows published since the last update, 0 if
+     * there is no new window. More than 1 means the consumer skipped windows.
+     */
+    uint32_t update();
+
+    /**
+     * Checks if the producer has started overwriting the current window or
+     * the windows before it since the last update().
+     *
+     * Call it after analysis: if it returns true, the analysis may have read
+     * partially written windows and its results should be discarded.
+     *
+     * @param depth The number of most recent windows analysis reads, 0 for
+     * the windows modules read: the current one back to the non-overlapping
+     * one, hopLag + 1 windows.
+     */
+    bool isOverrun(const uint16_t depth = 0) const;
+
+    /**
+     * Gets the total number of published windows the consumer skipped.
+     */
+    uint32_t getDroppedFrames() const { return this->droppedFrames; };
+
+    /**
+     * Clears the data buffer and resets both threads to the same slot.
+     *
+     * Not synchronized, only call it while the producer is stopped.
+     */
+    void clearBuffer();
+
+private:
+    // producer state
+    uint16_t writeIndex;
+    uint16_t writeHistoryIndex;
+
+    // sequence numbers shared by both threads
+    std::atomic<uint32_t> writeFrame;
+    std::atomic<uint32_t> publishedFrame;
+
+    // consumer state
+    uint32_t droppedFrames;
+
+    void init();
+};
+
+#endif // SHARED_SPECTROGRAM_H
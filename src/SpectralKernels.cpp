@@ -0,0 +1,1001 @@
+#include "SpectralKernels.h"
+
+#include <math.h>
+
+#ifndef ARDUINO
+#include <atomic>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AUDIOPRISM_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define AUDIOPRISM_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace AudioPrism {
+
+//============================================================================
+// SCALAR
+//============================================================================
+
+static float sum_scalar(const float* data, int n)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static float energy_scalar(const float* data, int n)
+{
+    float energy = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        energy += data[i] * data[i];
+    }
+    return energy;
+}
+
+static float flux_scalar(const float* curr, const float* prev, int n)
+{
+    float flux = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        float diff = curr[i] - prev[i];
+        flux += diff * diff;
+    }
+    return flux;
+}
+
+static float positive_flux_scalar(const float* curr, const float* prev, int n)
+{
+    float flux = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        // clamp without branching, the sign of consecutive differences is
+        // close to random
+        float diff = curr[i] - prev[i];
+        float inc  = 0.5f * (diff + fabsf(diff));
+        flux += inc * inc;
+    }
+    return flux;
+}
+
+static float negative_flux_scalar(const float* curr, const float* prev, int n)
+{
+    float flux = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        float diff = curr[i] - prev[i];
+        float dec  = 0.5f * (diff - fabsf(diff));
+        flux += dec * dec;
+    }
+    return flux;
+}
+
+static void smooth_scalar(const float* data, float* smoothed, int n, float factor)
+{
+    for (int i = 0; i < n; ++i) {
+        float new_weight = factor * data[i];
+        float old_weight = (1 - factor) * smoothed[i];
+        smoothed[i]      = new_weight + old_weight;
+    }
+}
+
+static float max_scalar(const float* data, int n, int* argmax)
+{
+    float maxVal = 0.0f;
+    int   index  = -1;
+    for (int i = 0; i < n; ++i) {
+        if (data[i] > maxVal) {
+            maxVal = data[i];
+            index  = i;
+        }
+    }
+    *argmax = index;
+    return maxVal;
+}
+
+// accumulates bins [i, n) into stats, e.g. after a vectorized pass over [0, i)
+static void stats_tail(const float* curr, const float* prev, int i, int n, KernelStats* stats)
+{
+    for (; i < n; ++i) {
+        float amp = curr[i];
+        stats->sum += amp;
+        stats->energy += amp * amp;
+        stats->weightedSum += float(i) * amp;
+        if (amp > stats->max) {
+            stats->max    = amp;
+            stats->argmax = i;
+        }
+        if (prev != NULL) {
+            float diff = amp - prev[i];
+            if (diff > 0) {
+                stats->positiveFlux += diff * diff;
+            } else {
+                stats->negativeFlux += diff * diff;
+            }
+        }
+    }
+}
+
+// single pass of the scalar stats kernel, the flux is a template parameter
+// so its branch is compiled out
+template <bool WithFlux>
+static void stats_scalar_pass(const float* curr, const float* prev, int n, KernelStats* stats)
+{
+    float sum = 0.0f, energy = 0.0f, maxVal = 0.0f, weightedSum = 0.0f;
+    float positiveFlux = 0.0f, negativeFlux = 0.0f;
+    float bin    = 0.0f; // float copy of i, avoids an int to float conversion per bin
+    int   argmax = -1;
+
+    for (int i = 0; i < n; ++i, bin += 1.0f) {
+        float amp = curr[i];
+
+        sum += amp;
+        energy += amp * amp;
+        weightedSum += bin * amp;
+        if (amp > maxVal) {
+            maxVal = amp;
+            argmax = i;
+        }
+
+        if (WithFlux) {
+            // split the difference without branching, the sign of
+            // consecutive differences is close to random
+            float diff = amp - prev[i];
+            float inc  = 0.5f * (diff + fabsf(diff));
+            float dec  = diff - inc;
+            positiveFlux += inc * inc;
+            negativeFlux += dec * dec;
+        }
+    }
+
+    stats->sum          = sum;
+    stats->energy       = energy;
+    stats->max          = maxVal;
+    stats->argmax       = argmax;
+    stats->weightedSum  = weightedSum;
+    stats->positiveFlux = positiveFlux;
+    stats->negativeFlux = negativeFlux;
+}
+
+static void stats_scalar(const float* curr, const float* prev, int n, KernelStats* stats)
+{
+    if (prev != NULL) {
+        stats_scalar_pass<true>(curr, prev, n, stats);
+    } else {
+        stats_scalar_pass<false>(curr, prev, n, stats);
+    }
+}
+
+// combines the maxima of the lanes of a vectorized pass, and the indices of
+// their first occurrence, into the first index of the overall maximum
+// lanes that never held a positive bin have an index of -1
+static void reduce_argmax(const float* maxima, const float* indices, int lanes, float* maxVal, int* argmax)
+{
+    *maxVal = 0.0f;
+    *argmax = -1;
+    for (int l = 0; l < lanes; ++l) {
+        if (indices[l] < 0.0f) {
+            continue;
+        }
+        int index = int(indices[l]);
+        if (maxima[l] > *maxVal || (maxima[l] == *maxVal && index < *argmax)) {
+            *maxVal = maxima[l];
+            *argmax = index;
+        }
+    }
+}
+
+static const SpectralKernels SCALAR_KERNELS = {
+    "scalar",
+    sum_scalar,
+    energy_scalar,
+    flux_scalar,
+    positive_flux_scalar,
+    negative_flux_scalar,
+    smooth_scalar,
+    max_scalar,
+    stats_scalar,
+};
+
+#if AUDIOPRISM_X86
+
+//============================================================================
+// SSE2
+//============================================================================
+
+__attribute__((target("sse2"))) static inline float hsum_sse2(__m128 v)
+{
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf        = _mm_movehl_ps(shuf, sums);
+    sums        = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+__attribute__((target("sse2"))) static float sum_sse2(const float* data, int n)
+{
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    int    i    = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_loadu_ps(data + i));
+        acc1 = _mm_add_ps(acc1, _mm_loadu_ps(data + i + 4));
+    }
+    float sum = hsum_sse2(_mm_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+__attribute__((target("sse2"))) static float energy_sse2(const float* data, int n)
+{
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    int    i    = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_loadu_ps(data + i);
+        __m128 b = _mm_loadu_ps(data + i + 4);
+        acc0     = _mm_add_ps(acc0, _mm_mul_ps(a, a));
+        acc1     = _mm_add_ps(acc1, _mm_mul_ps(b, b));
+    }
+    float energy = hsum_sse2(_mm_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        energy += data[i] * data[i];
+    }
+    return energy;
+}
+
+// the three flux kernels differ only in how the difference is clamped
+#define AUDIOPRISM_FLUX_SSE2(NAME, CLAMP, SCALAR_COND)                                 \
+    __attribute__((target("sse2"))) static float NAME(const float* curr, const float* prev, int n) \
+    {                                                                                  \
+        const __m128 zero = _mm_setzero_ps();                                          \
+        __m128       acc  = zero;                                                      \
+        int          i    = 0;                                                         \
+        (void)zero;                                                                    \
+        for (; i + 4 <= n; i += 4) {                                                   \
+            __m128 d = _mm_sub_ps(_mm_loadu_ps(curr + i), _mm_loadu_ps(prev + i));     \
+            d        = CLAMP;                                                          \
+            acc      = _mm_add_ps(acc, _mm_mul_ps(d, d));                              \
+        }                                                                              \
+        float flux = hsum_sse2(acc);                                                   \
+        for (; i < n; ++i) {                                                           \
+            float diff = curr[i] - prev[i];                                            \
+            if (SCALAR_COND) {                                                         \
+                flux += diff * diff;                                                   \
+            }                                                                          \
+        }                                                                              \
+        return flux;                                                                   \
+    }
+
+AUDIOPRISM_FLUX_SSE2(flux_sse2, d, true)
+AUDIOPRISM_FLUX_SSE2(positive_flux_sse2, _mm_max_ps(d, zero), diff > 0)
+AUDIOPRISM_FLUX_SSE2(negative_flux_sse2, _mm_min_ps(d, zero), diff < 0)
+
+__attribute__((target("sse2"))) static void smooth_sse2(const float* data, float* smoothed,
+    int n, float factor)
+{
+    const __m128 newFactor = _mm_set1_ps(factor);
+    const __m128 oldFactor = _mm_set1_ps(1 - factor);
+    int          i         = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 newWeight = _mm_mul_ps(newFactor, _mm_loadu_ps(data + i));
+        __m128 oldWeight = _mm_mul_ps(oldFactor, _mm_loadu_ps(smoothed + i));
+        _mm_storeu_ps(smoothed + i, _mm_add_ps(newWeight, oldWeight));
+    }
+    smooth_scalar(data + i, smoothed + i, n - i, factor);
+}
+
+// the maximum of each lane and the index of its first occurrence are kept
+// without branching, then reduced by reduce_argmax()
+__attribute__((target("sse2"))) static float max_sse2(const float* data, int n, int* argmax)
+{
+    const __m128 step    = _mm_set1_ps(4.0f);
+    __m128       maxima  = _mm_setzero_ps();
+    __m128       indices = _mm_set1_ps(-1.0f);
+    __m128       bins    = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    int          i       = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 a       = _mm_loadu_ps(data + i);
+        __m128 greater = _mm_cmpgt_ps(a, maxima);
+        maxima         = _mm_max_ps(maxima, a);
+        indices        = _mm_or_ps(_mm_and_ps(greater, bins), _mm_andnot_ps(greater, indices));
+        bins           = _mm_add_ps(bins, step);
+    }
+
+    float maxLanes[4], indexLanes[4], maxVal;
+    _mm_storeu_ps(maxLanes, maxima);
+    _mm_storeu_ps(indexLanes, indices);
+    reduce_argmax(maxLanes, indexLanes, 4, &maxVal, argmax);
+    for (; i < n; ++i) {
+        if (data[i] > maxVal) {
+            maxVal  = data[i];
+            *argmax = i;
+        }
+    }
+    return maxVal;
+}
+
+template <bool WithFlux>
+__attribute__((target("sse2"))) static void stats_sse2_pass(const float* curr, const float* prev,
+    int n, KernelStats* stats)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 step = _mm_set1_ps(4.0f);
+    __m128       sum = zero, energy = zero, weightedSum = zero;
+    __m128       positiveFlux = zero, negativeFlux = zero;
+    __m128       maxima  = zero;
+    __m128       indices = _mm_set1_ps(-1.0f);
+    __m128       bins    = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    int          i       = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 a    = _mm_loadu_ps(curr + i);
+        sum         = _mm_add_ps(sum, a);
+        energy      = _mm_add_ps(energy, _mm_mul_ps(a, a));
+        weightedSum = _mm_add_ps(weightedSum, _mm_mul_ps(bins, a));
+
+        __m128 greater = _mm_cmpgt_ps(a, maxima);
+        maxima         = _mm_max_ps(maxima, a);
+        indices        = _mm_or_ps(_mm_and_ps(greater, bins), _mm_andnot_ps(greater, indices));
+
+        if (WithFlux) {
+            __m128 d     = _mm_sub_ps(a, _mm_loadu_ps(prev + i));
+            __m128 inc   = _mm_max_ps(d, zero);
+            __m128 dec   = _mm_min_ps(d, zero);
+            positiveFlux = _mm_add_ps(positiveFlux, _mm_mul_ps(inc, inc));
+            negativeFlux = _mm_add_ps(negativeFlux, _mm_mul_ps(dec, dec));
+        }
+        bins = _mm_add_ps(bins, step);
+    }
+
+    float maxLanes[4], indexLanes[4];
+    _mm_storeu_ps(maxLanes, maxima);
+    _mm_storeu_ps(indexLanes, indices);
+    reduce_argmax(maxLanes, indexLanes, 4, &stats->max, &stats->argmax);
+    stats->sum          = hsum_sse2(sum);
+    stats->energy       = hsum_sse2(energy);
+    stats->weightedSum  = hsum_sse2(weightedSum);
+    stats->positiveFlux = hsum_sse2(positiveFlux);
+    stats->negativeFlux = hsum_sse2(negativeFlux);
+    stats_tail(curr, WithFlux ? prev : NULL, i, n, stats);
+}
+
+static void stats_sse2(const float* curr, const float* prev, int n, KernelStats* stats)
+{
+    if (prev != NULL) {
+        stats_sse2_pass<true>(curr, prev, n, stats);
+    } else {
+        stats_sse2_pass<false>(curr, prev, n, stats);
+    }
+}
+
+static const SpectralKernels SSE2_KERNELS = {
+    "sse2",
+    sum_sse2,
+    energy_sse2,
+    flux_sse2,
+    positive_flux_sse2,
+    negative_flux_sse2,
+    smooth_sse2,
+    max_sse2,
+    stats_sse2,
+};
+
+//============================================================================
+// AVX2 + FMA
+//============================================================================
+
+__attribute__((target("avx2,fma"))) static inline float hsum_avx2(__m256 v)
+{
+    __m128 sums = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 shuf = _mm_movehdup_ps(sums);
+    sums        = _mm_add_ps(sums, shuf);
+    shuf        = _mm_movehl_ps(shuf, sums);
+    sums        = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+__attribute__((target("avx2,fma"))) static float sum_avx2(const float* data, int n)
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int    i    = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(data + i));
+        acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(data + i + 8));
+    }
+    float sum = hsum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma"))) static float energy_avx2(const float* data, int n)
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int    i    = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a = _mm256_loadu_ps(data + i);
+        __m256 b = _mm256_loadu_ps(data + i + 8);
+        acc0     = _mm256_fmadd_ps(a, a, acc0);
+        acc1     = _mm256_fmadd_ps(b, b, acc1);
+    }
+    float energy = hsum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        energy += data[i] * data[i];
+    }
+    return energy;
+}
+
+#define AUDIOPRISM_FLUX_AVX2(NAME, CLAMP, SCALAR_COND)                                     \
+    __attribute__((target("avx2,fma"))) static float NAME(const float* curr, const float* prev, int n) \
+    {                                                                                      \
+        const __m256 zero = _mm256_setzero_ps();                                           \
+        __m256       acc  = zero;                                                          \
+        int          i    = 0;                                                             \
+        (void)zero;                                                                        \
+        for (; i + 8 <= n; i += 8) {                                                       \
+            __m256 d = _mm256_sub_ps(_mm256_loadu_ps(curr + i), _mm256_loadu_ps(prev + i)); \
+            d        = CLAMP;                                                              \
+            acc      = _mm256_fmadd_ps(d, d, acc);                                         \
+        }                                                                                  \
+        float flux = hsum_avx2(acc);                                                       \
+        for (; i < n; ++i) {                                                               \
+            float diff = curr[i] - prev[i];                                                \
+            if (SCALAR_COND) {                                                             \
+                flux += diff * diff;                                                       \
+            }                                                                              \
+        }                                                                                  \
+        return flux;                                                                       \
+    }
+
+AUDIOPRISM_FLUX_AVX2(flux_avx2, d, true)
+AUDIOPRISM_FLUX_AVX2(positive_flux_avx2, _mm256_max_ps(d, zero), diff > 0)
+AUDIOPRISM_FLUX_AVX2(negative_flux_avx2, _mm256_min_ps(d, zero), diff < 0)
+
+__attribute__((target("avx2,fma"))) static void smooth_avx2(const float* data, float* smoothed,
+    int n, float factor)
+{
+    const __m256 newFactor = _mm256_set1_ps(factor);
+    const __m256 oldFactor = _mm256_set1_ps(1 - factor);
+    int          i         = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 oldWeight = _mm256_mul_ps(oldFactor, _mm256_loadu_ps(smoothed + i));
+        _mm256_storeu_ps(smoothed + i, _mm256_fmadd_ps(newFactor, _mm256_loadu_ps(data + i), oldWeight));
+    }
+    smooth_scalar(data + i, smoothed + i, n - i, factor);
+}
+
+__attribute__((target("avx2,fma"))) static float max_avx2(const float* data, int n, int* argmax)
+{
+    const __m256 step    = _mm256_set1_ps(8.0f);
+    __m256       maxima  = _mm256_setzero_ps();
+    __m256       indices = _mm256_set1_ps(-1.0f);
+    __m256       bins    = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    int          i       = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 a       = _mm256_loadu_ps(data + i);
+        __m256 greater = _mm256_cmp_ps(a, maxima, _CMP_GT_OQ);
+        maxima         = _mm256_max_ps(maxima, a);
+        indices        = _mm256_blendv_ps(indices, bins, greater);
+        bins           = _mm256_add_ps(bins, step);
+    }
+
+    float maxLanes[8], indexLanes[8], maxVal;
+    _mm256_storeu_ps(maxLanes, maxima);
+    _mm256_storeu_ps(indexLanes, indices);
+    reduce_argmax(maxLanes, indexLanes, 8, &maxVal, argmax);
+    for (; i < n; ++i) {
+        if (data[i] > maxVal) {
+            maxVal  = data[i];
+            *argmax = i;
+        }
+    }
+    return maxVal;
+}
+
+template <bool WithFlux>
+__attribute__((target("avx2,fma"))) static void stats_avx2_pass(const float* curr, const float* prev,
+    int n, KernelStats* stats)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 step = _mm256_set1_ps(8.0f);
+    __m256       sum = zero, energy = zero, weightedSum = zero;
+    __m256       positiveFlux = zero, negativeFlux = zero;
+    __m256       maxima  = zero;
+    __m256       indices = _mm256_set1_ps(-1.0f);
+    __m256       bins    = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    int          i       = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 a    = _mm256_loadu_ps(curr + i);
+        sum         = _mm256_add_ps(sum, a);
+        energy      = _mm256_fmadd_ps(a, a, energy);
+        weightedSum = _mm256_fmadd_ps(bins, a, weightedSum);
+
+        __m256 greater = _mm256_cmp_ps(a, maxima, _CMP_GT_OQ);
+        maxima         = _mm256_max_ps(maxima, a);
+        indices        = _mm256_blendv_ps(indices, bins, greater);
+
+        if (WithFlux) {
+            __m256 d     = _mm256_sub_ps(a, _mm256_loadu_ps(prev + i));
+            __m256 inc   = _mm256_max_ps(d, zero);
+            __m256 dec   = _mm256_min_ps(d, zero);
+            positiveFlux = _mm256_fmadd_ps(inc, inc, positiveFlux);
+            negativeFlux = _mm256_fmadd_ps(dec, dec, negativeFlux);
+        }
+        bins = _mm256_add_ps(bins, step);
+    }
+
+    float maxLanes[8], indexLanes[8];
+    _mm256_storeu_ps(maxLanes, maxima);
+    _mm256_storeu_ps(indexLanes, indices);
+    reduce_argmax(maxLanes, indexLanes, 8, &stats->max, &stats->argmax);
+    stats->sum          = hsum_avx2(sum);
+    stats->energy       = hsum_avx2(energy);
+    stats->weightedSum  = hsum_avx2(weightedSum);
+    stats->positiveFlux = hsum_avx2(positiveFlux);
+    stats->negativeFlux = hsum_avx2(negativeFlux);
+    stats_tail(curr, WithFlux ? prev : NULL, i, n, stats);
+}
+
+static void stats_avx2(const float* curr, const float* prev, int n, KernelStats* stats)
+{
+    if (prev != NULL) {
+        stats_avx2_pass<true>(curr, prev, n, stats);
+    } else {
+        stats_avx2_pass<false>(curr, prev, n, stats);
+    }
+}
+
+static const SpectralKernels AVX2_KERNELS = {
+    "avx2",
+    sum_avx2,
+    energy_avx2,
+    flux_avx2,
+    positive_flux_avx2,
+    negative_flux_avx2,
+    smooth_avx2,
+    max_avx2,
+    stats_avx2,
+};
+
+//============================================================================
+// AVX-512
+//============================================================================
+
+// the remainder of each loop is handled with a masked load, zeroed lanes do
+// not contribute to any of the sums
+
+__attribute__((target("avx512f"))) static inline __mmask16 tail_mask(int remaining)
+{
+    return (__mmask16)((1u << remaining) - 1);
+}
+
+// horizontal sum of the lanes through memory, calling hsum_avx2() on the
+// halves is not inlined into avx512f code and costs more than the pass.
+// GCC's _mm512_reduce_add_ps() is not used either: it reads an undefined
+// register and warns under -Wmaybe-uninitialized (as do _mm512_max_ps()
+// and _mm512_min_ps(), so the flux kernels clamp with compare masks)
+__attribute__((target("avx512f"))) static inline float hsum_avx512(__m512 v)
+{
+    float lanes[16];
+    _mm512_storeu_ps(lanes, v);
+
+    float sum = 0.0f;
+    for (int l = 0; l < 16; ++l) {
+        sum += lanes[l];
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f"))) static float sum_avx512(const float* data, int n)
+{
+    __m512 acc = _mm512_setzero_ps();
+    int    i   = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc = _mm512_add_ps(acc, _mm512_loadu_ps(data + i));
+    }
+    if (i < n) {
+        acc = _mm512_add_ps(acc, _mm512_maskz_loadu_ps(tail_mask(n - i), data + i));
+    }
+    return hsum_avx512(acc);
+}
+
+__attribute__((target("avx512f"))) static float energy_avx512(const float* data, int n)
+{
+    __m512 acc = _mm512_setzero_ps();
+    int    i   = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 a = _mm512_loadu_ps(data + i);
+        acc      = _mm512_fmadd_ps(a, a, acc);
+    }
+    if (i < n) {
+        __m512 a = _mm512_maskz_loadu_ps(tail_mask(n - i), data + i);
+        acc      = _mm512_fmadd_ps(a, a, acc);
+    }
+    return hsum_avx512(acc);
+}
+
+#define AUDIOPRISM_FLUX_AVX512(NAME, CLAMP)                                                   \
+    __attribute__((target("avx512f"))) static float NAME(const float* curr, const float* prev, int n) \
+    {                                                                                         \
+        const __m512 zero = _mm512_setzero_ps();                                              \
+        __m512       acc  = zero;                                                             \
+        int          i    = 0;                                                                \
+        (void)zero;                                                                           \
+        for (; i + 16 <= n; i += 16) {                                                        \
+            __m512 d = _mm512_sub_ps(_mm512_loadu_ps(curr + i), _mm512_loadu_ps(prev + i));  \
+            d        = CLAMP;                                                                 \
+            acc      = _mm512_fmadd_ps(d, d, acc);                                            \
+        }                                                                                     \
+        if (i < n) {                                                                          \
+            __mmask16 mask = tail_mask(n - i);                                                \
+            __m512    d    = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, curr + i),             \
+                      _mm512_maskz_loadu_ps(mask, prev + i));                                 \
+            d              = CLAMP;                                                           \
+            acc            = _mm512_fmadd_ps(d, d, acc);                                      \
+        }                                                                                     \
+        return hsum_avx512(acc);                                                     \
+    }
+
+AUDIOPRISM_FLUX_AVX512(flux_avx512, d)
+AUDIOPRISM_FLUX_AVX512(positive_flux_avx512, _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(d, zero, _CMP_GT_OQ), d))
+AUDIOPRISM_FLUX_AVX512(negative_flux_avx512, _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(d, zero, _CMP_LT_OQ), d))
+
+__attribute__((target("avx512f"))) static void smooth_avx512(const float* data, float* smoothed,
+    int n, float factor)
+{
+    const __m512 newFactor = _mm512_set1_ps(factor);
+    const __m512 oldFactor = _mm512_set1_ps(1 - factor);
+    int          i         = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 oldWeight = _mm512_mul_ps(oldFactor, _mm512_loadu_ps(smoothed + i));
+        _mm512_storeu_ps(smoothed + i, _mm512_fmadd_ps(newFactor, _mm512_loadu_ps(data + i), oldWeight));
+    }
+    if (i < n) {
+        __mmask16 mask      = tail_mask(n - i);
+        __m512    oldWeight = _mm512_mul_ps(oldFactor, _mm512_maskz_loadu_ps(mask, smoothed + i));
+        _mm512_mask_storeu_ps(smoothed + i, mask,
+            _mm512_fmadd_ps(newFactor, _mm512_maskz_loadu_ps(mask, data + i), oldWeight));
+    }
+}
+
+__attribute__((target("avx512f"))) static float max_avx512(const float* data, int n, int* argmax)
+{
+    const __m512 step    = _mm512_set1_ps(16.0f);
+    __m512       maxima  = _mm512_setzero_ps();
+    __m512       indices = _mm512_set1_ps(-1.0f);
+    __m512       bins    = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+        8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+    for (int i = 0; i < n; i += 16) {
+        __m512 a = (i + 16 <= n) ? _mm512_loadu_ps(data + i)
+                                 : _mm512_maskz_loadu_ps(tail_mask(n - i), data + i);
+        __mmask16 greater = _mm512_cmp_ps_mask(a, maxima, _CMP_GT_OQ);
+        maxima            = _mm512_mask_blend_ps(greater, maxima, a);
+        indices           = _mm512_mask_blend_ps(greater, indices, bins);
+        bins              = _mm512_add_ps(bins, step);
+    }
+
+    float maxLanes[16], indexLanes[16], maxVal;
+    _mm512_storeu_ps(maxLanes, maxima);
+    _mm512_storeu_ps(indexLanes, indices);
+    reduce_argmax(maxLanes, indexLanes, 16, &maxVal, argmax);
+    return maxVal;
+}
+
+template <bool WithFlux>
+__attribute__((target("avx512f"))) static void stats_avx512_pass(const float* curr, const float* prev,
+    int n, KernelStats* stats)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 step = _mm512_set1_ps(16.0f);
+    __m512       sum = zero, energy = zero, weightedSum = zero;
+    __m512       positiveFlux = zero, negativeFlux = zero;
+    __m512       maxima  = zero;
+    __m512       indices = _mm512_set1_ps(-1.0f);
+    __m512       bins    = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+        8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 mask = (i + 16 <= n) ? (__mmask16)0xffff : tail_mask(n - i);
+        __m512    a    = _mm512_maskz_loadu_ps(mask, curr + i);
+        sum            = _mm512_add_ps(sum, a);
+        energy         = _mm512_fmadd_ps(a, a, energy);
+        weightedSum    = _mm512_fmadd_ps(bins, a, weightedSum);
+
+        __mmask16 greater = _mm512_cmp_ps_mask(a, maxima, _CMP_GT_OQ);
+        maxima            = _mm512_mask_blend_ps(greater, maxima, a);
+        indices           = _mm512_mask_blend_ps(greater, indices, bins);
+
+        if (WithFlux) {
+            __m512 d     = _mm512_sub_ps(a, _mm512_maskz_loadu_ps(mask, prev + i));
+            __m512 inc   = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(d, zero, _CMP_GT_OQ), d);
+            __m512 dec   = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(d, zero, _CMP_LT_OQ), d);
+            positiveFlux = _mm512_fmadd_ps(inc, inc, positiveFlux);
+            negativeFlux = _mm512_fmadd_ps(dec, dec, negativeFlux);
+        }
+        bins = _mm512_add_ps(bins, step);
+    }
+
+    float maxLanes[16], indexLanes[16];
+    _mm512_storeu_ps(maxLanes, maxima);
+    _mm512_storeu_ps(indexLanes, indices);
+    reduce_argmax(maxLanes, indexLanes, 16, &stats->max, &stats->argmax);
+    stats->sum          = hsum_avx512(sum);
+    stats->energy       = hsum_avx512(energy);
+    stats->weightedSum  = hsum_avx512(weightedSum);
+    stats->positiveFlux = hsum_avx512(positiveFlux);
+    stats->negativeFlux = hsum_avx512(negativeFlux);
+}
+
+static void stats_avx512(const float* curr, const float* prev, int n, KernelStats* stats)
+{
+    if (prev != NULL) {
+        stats_avx512_pass<true>(curr, prev, n, stats);
+    } else {
+        stats_avx512_pass<false>(curr, prev, n, stats);
+    }
+}
+
+static const SpectralKernels AVX512_KERNELS = {
+    "avx512",
+    sum_avx512,
+    energy_avx512,
+    flux_avx512,
+    positive_flux_avx512,
+    negative_flux_avx512,
+    smooth_avx512,
+    max_avx512,
+    stats_avx512,
+};
+
+#endif // AUDIOPRISM_X86
+
+#if AUDIOPRISM_NEON
+
+//============================================================================
+// NEON
+//============================================================================
+
+static inline float hsum_neon(float32x4_t v)
+{
+    float32x2_t sums = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(sums, sums), 0);
+}
+
+static float sum_neon(const float* data, int n)
+{
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    int         i   = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = vaddq_f32(acc, vld1q_f32(data + i));
+    }
+    float sum = hsum_neon(acc);
+    for (; i < n; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static float energy_neon(const float* data, int n)
+{
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    int         i   = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t a = vld1q_f32(data + i);
+        acc           = vmlaq_f32(acc, a, a);
+    }
+    float energy = hsum_neon(acc);
+    for (; i < n; ++i) {
+        energy += data[i] * data[i];
+    }
+    return energy;
+}
+
+#define AUDIOPRISM_FLUX_NEON(NAME, CLAMP, SCALAR_COND)                        \
+    static float NAME(const float* curr, const float* prev, int n)            \
+    {                                                                         \
+        const float32x4_t zero = vdupq_n_f32(0.0f);                           \
+        float32x4_t       acc  = zero;                                        \
+        int               i    = 0;                                           \
+        (void)zero;                                                           \
+        for (; i + 4 <= n; i += 4) {                                          \
+            float32x4_t d = vsubq_f32(vld1q_f32(curr + i), vld1q_f32(prev + i)); \
+            d             = CLAMP;                                            \
+            acc           = vmlaq_f32(acc, d, d);                             \
+        }                                                                     \
+        float flux = hsum_neon(acc);                                          \
+        for (; i < n; ++i) {                                                  \
+            float diff = curr[i] - prev[i];                                   \
+            if (SCALAR_COND) {                                                \
+                flux += diff * diff;                                          \
+            }                                                                 \
+        }                                                                     \
+        return flux;                                                          \
+    }
+
+AUDIOPRISM_FLUX_NEON(flux_neon, d, true)
+AUDIOPRISM_FLUX_NEON(positive_flux_neon, vmaxq_f32(d, zero), diff > 0)
+AUDIOPRISM_FLUX_NEON(negative_flux_neon, vminq_f32(d, zero), diff < 0)
+
+static void smooth_neon(const float* data, float* smoothed, int n, float factor)
+{
+    const float32x4_t newFactor = vdupq_n_f32(factor);
+    const float32x4_t oldFactor = vdupq_n_f32(1 - factor);
+    int               i         = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t oldWeight = vmulq_f32(oldFactor, vld1q_f32(smoothed + i));
+        vst1q_f32(smoothed + i, vmlaq_f32(oldWeight, newFactor, vld1q_f32(data + i)));
+    }
+    smooth_scalar(data + i, smoothed + i, n - i, factor);
+}
+
+static float max_neon(const float* data, int n, int* argmax)
+{
+    static const float firstBins[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const float32x4_t  step         = vdupq_n_f32(4.0f);
+    float32x4_t        maxima       = vdupq_n_f32(0.0f);
+    float32x4_t        indices      = vdupq_n_f32(-1.0f);
+    float32x4_t        bins         = vld1q_f32(firstBins);
+    int                i            = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t a       = vld1q_f32(data + i);
+        uint32x4_t  greater = vcgtq_f32(a, maxima);
+        maxima              = vbslq_f32(greater, a, maxima);
+        indices             = vbslq_f32(greater, bins, indices);
+        bins                = vaddq_f32(bins, step);
+    }
+
+    float maxLanes[4], indexLanes[4], maxVal;
+    vst1q_f32(maxLanes, maxima);
+    vst1q_f32(indexLanes, indices);
+    reduce_argmax(maxLanes, indexLanes, 4, &maxVal, argmax);
+    for (; i < n; ++i) {
+        if (data[i] > maxVal) {
+            maxVal  = data[i];
+            *argmax = i;
+        }
+    }
+    return maxVal;
+}
+
+template <bool WithFlux>
+static void stats_neon_pass(const float* curr, const float* prev, int n, KernelStats* stats)
+{
+    static const float firstBins[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const float32x4_t  zero         = vdupq_n_f32(0.0f);
+    const float32x4_t  step         = vdupq_n_f32(4.0f);
+    float32x4_t        sum = zero, energy = zero, weightedSum = zero;
+    float32x4_t        positiveFlux = zero, negativeFlux = zero;
+    float32x4_t        maxima  = zero;
+    float32x4_t        indices = vdupq_n_f32(-1.0f);
+    float32x4_t        bins    = vld1q_f32(firstBins);
+    int                i       = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t a = vld1q_f32(curr + i);
+        sum           = vaddq_f32(sum, a);
+        energy        = vmlaq_f32(energy, a, a);
+        weightedSum   = vmlaq_f32(weightedSum, bins, a);
+
+        uint32x4_t greater = vcgtq_f32(a, maxima);
+        maxima             = vbslq_f32(greater, a, maxima);
+        indices            = vbslq_f32(greater, bins, indices);
+
+        if (WithFlux) {
+            float32x4_t d   = vsubq_f32(a, vld1q_f32(prev + i));
+            float32x4_t inc = vmaxq_f32(d, zero);
+            float32x4_t dec = vminq_f32(d, zero);
+            positiveFlux    = vmlaq_f32(positiveFlux, inc, inc);
+            negativeFlux    = vmlaq_f32(negativeFlux, dec, dec);
+        }
+        bins = vaddq_f32(bins, step);
+    }
+
+    float maxLanes[4], indexLanes[4];
+    vst1q_f32(maxLanes, maxima);
+    vst1q_f32(indexLanes, indices);
+    reduce_argmax(maxLanes, indexLanes, 4, &stats->max, &stats->argmax);
+    stats->sum          = hsum_neon(sum);
+    stats->energy       = hsum_neon(energy);
+    stats->weightedSum  = hsum_neon(weightedSum);
+    stats->positiveFlux = hsum_neon(positiveFlux);
+    stats->negativeFlux = hsum_neon(negativeFlux);
+    stats_tail(curr, WithFlux ? prev : NULL, i, n, stats);
+}
+
+static void stats_neon(const float* curr, const float* prev, int n, KernelStats* stats)
+{
+    if (prev != NULL) {
+        stats_neon_pass<true>(curr, prev, n, stats);
+    } else {
+        stats_neon_pass<false>(curr, prev, n, stats);
+    }
+}
+
+static const SpectralKernels NEON_KERNELS = {
+    "neon",
+    sum_neon,
+    energy_neon,
+    flux_neon,
+    positive_flux_neon,
+    negative_flux_neon,
+    smooth_neon,
+    max_neon,
+    stats_neon,
+};
+
+#endif // AUDIOPRISM_NEON
+
+//============================================================================
+// DISPATCH
+//============================================================================
+
+// kernel set installed with set_kernels(), overrides the detected set
+// on hosts it is atomic, as analysis threads read it while a bench or a
+// setup routine may replace it
+#ifndef ARDUINO
+static std::atomic<const SpectralKernels*> installedKernels(NULL);
+#else
+static const SpectralKernels* installedKernels = NULL;
+#endif
+
+int available_kernels(const SpectralKernels** sets, int maxSets)
+{
+    const SpectralKernels* supported[4];
+    int                    numSupported = 0;
+
+    supported[numSupported++] = &SCALAR_KERNELS;
+
+#if AUDIOPRISM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        supported[numSupported++] = &SSE2_KERNELS;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        supported[numSupported++] = &AVX2_KERNELS;
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        supported[numSupported++] = &AVX512_KERNELS;
+    }
+#elif AUDIOPRISM_NEON
+    supported[numSupported++] = &NEON_KERNELS;
+#endif
+
+    int count = 0;
+    for (int i = 0; i < numSupported && count < maxSets; i++) {
+        sets[count++] = supported[i];
+    }
+    return count;
+}
+
+// the widest supported set is listed last
+static const SpectralKernels* detect_kernels()
+{
+    const SpectralKernels* sets[4];
+    int                    count = available_kernels(sets, 4);
+    return sets[count - 1];
+}
+
+const SpectralKernels& get_kernels()
+{
+    const SpectralKernels* installed = installedKernels;
+    if (installed != NULL) {
+        return *installed;
+    }
+
+    // detection runs once, on first use (thread-safe static initialization)
+    static const SpectralKernels* detectedKernels = detect_kernels();
+    return *detectedKernels;
+}
+
+void set_kernels(const SpectralKernels& kernels)
+{
+    installedKernels = &kernels;
+}
+
+const SpectralKernels& scalar_kernels()
+{
+    return SCALAR_KERNELS;
+}
+
+} // AudioPrism
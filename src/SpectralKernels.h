@@ -0,0 +1,100 @@
+/*
+ * @file
+ * Contains the vectorized kernels behind the SpectralTools helpers.
+ */
+
+#ifndef SPECTRAL_KERNELS_H
+#define SPECTRAL_KERNELS_H
+
+namespace AudioPrism {
+
+/**
+ * Statistics of n contiguous bins, computed in one pass by the stats kernel.
+ * Bin indices are relative to the first bin.
+ */
+struct KernelStats {
+    float sum;          // sum of curr[i]
+    float energy;       // sum of curr[i]^2
+    float max;          // maximum of curr[i], 0 if no bin is positive
+    int   argmax;       // first index of the maximum, -1 if no bin is positive
+    float weightedSum;  // sum of i * curr[i]
+    float positiveFlux; // sum of (curr[i] - prev[i])^2 where curr[i] > prev[i]
+    float negativeFlux; // sum of (curr[i] - prev[i])^2 where curr[i] < prev[i]
+};
+
+/**
+ * A set of implementations of the inner loops of the SpectralTools helpers.
+ *
+ * All kernels operate on n contiguous bins. Every set computes the same
+ * results as the scalar set, up to floating point reassociation: vectorized
+ * sets sum in a different order, and may use fused multiply-adds, so results
+ * agree within a small relative tolerance rather than bit for bit.
+ * Maxima and their indices are exact.
+ *
+ * The best set supported by the CPU is selected the first time
+ * get_kernels() is called. Platforms with SIMD extensions that cannot be
+ * detected at runtime (e.g. the ESP32-S3 PIE instructions through esp-dsp)
+ * can install their own set with set_kernels().
+ */
+struct SpectralKernels {
+    const char* name;
+
+    // sum of data[0..n)
+    float (*sum)(const float* data, int n);
+
+    // sum of data[i]^2
+    float (*energy)(const float* data, int n);
+
+    // sum of (curr[i] - prev[i])^2
+    float (*flux)(const float* curr, const float* prev, int n);
+
+    // sum of (curr[i] - prev[i])^2 where curr[i] > prev[i]
+    float (*positive_flux)(const float* curr, const float* prev, int n);
+
+    // sum of (curr[i] - prev[i])^2 where curr[i] < prev[i]
+    float (*negative_flux)(const float* curr, const float* prev, int n);
+
+    // smoothed[i] = factor * data[i] + (1 - factor) * smoothed[i]
+    void (*smooth)(const float* data, float* smoothed, int n, float factor);
+
+    // maximum of data[0..n), 0 if no bin is positive, and its first index in
+    // argmax, -1 if no bin is positive
+    float (*max)(const float* data, int n, int* argmax);
+
+    // every statistic of KernelStats in a single pass over the bins, the flux
+    // ones only if prev is not NULL (they are 0 otherwise)
+    void (*stats)(const float* curr, const float* prev, int n, KernelStats* stats);
+};
+
+/**
+ * Gets the active kernel set.
+ *
+ * On first use, selects the widest instruction set the CPU supports.
+ */
+const SpectralKernels& get_kernels();
+
+/**
+ * Replaces the active kernel set, e.g. with a platform specific one.
+ *
+ * The kernel set must outlive its use. This is not synchronized with
+ * concurrent analysis, call it during setup.
+ */
+void set_kernels(const SpectralKernels& kernels);
+
+/**
+ * Gets the portable scalar kernel set, the reference for all others.
+ */
+const SpectralKernels& scalar_kernels();
+
+/**
+ * Gets the kernel sets that can run on this CPU, from narrowest to widest.
+ *
+ * @param sets Output array for up to maxSets kernel sets
+ * @param maxSets Capacity of the output array
+ * @return The number of kernel sets written to the output array
+ */
+int available_kernels(const SpectralKernels** sets, int maxSets);
+
+} // AudioPrism
+
+#endif // SPECTRAL_KERNELS_H
@@ -2,39 +2,261 @@
 #define SPECTRAL_TOOLS_H
 
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <vector>
 
 #include "Config.h"
-#include "HardwareSerial.h"
+#include "Platform.h"
+#include "SpectralKernels.h"
 
 namespace AudioPrism {
 
 /**
- * Calculate the total amplitude sum of the spectrum over a frequency range.
+ * Convert a frequency range to the half-open range of bins it covers.
  *
- * @param windowData The input spectrum data
- * @param lowerFreq The lower frequency bound to analyze
- * @param upperFreq The upper frequency bound to analyze
+ * @param lowerFreq The lower frequency bound
+ * @param upperFreq The upper frequency bound
+ * @param lowerBin Output, the lower bin bound
+ * @param upperBin Output, the upper bin bound
+ * @return false if the frequency range is invalid
  */
-inline float sum(const float* windowData, int lowerFreq, int upperFreq)
+inline bool freq_to_bin_range(int lowerFreq, int upperFreq, int& lowerBin, int& upperBin)
 {
     if (lowerFreq < 0 || upperFreq > SAMPLE_RATE >> 1 || lowerFreq > upperFreq) {
-        return -1;
+        return false;
+    }
+
+    float freqWidth = (float)WINDOW_SIZE / (float)SAMPLE_RATE;
+    lowerBin        = round(lowerFreq * freqWidth);
+    upperBin        = round(upperFreq * freqWidth);
+    return true;
+}
+
+/**
+ * Approximate the base 2 logarithm of a positive, normal float.
+ *
+ * The float is split into its exponent e and a mantissa m in
+ * [sqrt(0.5), sqrt(2)), so that log2(x) = e + log2(m). log2(m) is
+ * approximated by a degree 5 polynomial in (m - 1), fit to minimize the
+ * maximum error. The absolute error is below 2e-5 over the whole range,
+ * which also bounds the absolute error of a normalized entropy.
+ *
+ * Zero, negative, denormal and non-finite inputs are not supported.
+ *
+ * @param x The value to take the logarithm of
+ */
+inline float fast_log2(float x)
+{
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+
+    // subtracting the bits of sqrt(0.5) before extracting the exponent
+    // rounds it so that the remaining mantissa is centered around 1
+    int32_t exponent = (int32_t)(bits - 0x3f3504f3) >> 23;
+    bits -= (uint32_t)exponent << 23;
+
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    float t = m - 1.0f;
+
+    float p = 0.252597749f;
+    p       = p * t - 0.394479781f;
+    p       = p * t + 0.486675411f;
+    p       = p * t - 0.720248342f;
+    p       = p * t + 1.44257855f;
+
+    return float(exponent) + t * p;
+}
+
+/**
+ * The base 2 logarithm used by all entropy computations.
+ *
+ * Uses fast_log2() if FAST_LOG2 is enabled in Config.h, otherwise the C
+ * library's log2f().
+ */
+inline float entropy_log2(float x)
+{
+#if FAST_LOG2
+    return fast_log2(x);
+#else
+    return log2f(x);
+#endif
+}
+
+/**
+ * Statistics of a spectrum over a bin range, see spectral_stats().
+ */
+struct SpectralStats {
+    float sum;          // amplitude sum
+    float energy;       // sum of squared amplitudes
+    float max;          // maximum amplitude
+    int   argmax;       // bin index of the maximum amplitude, -1 if all bins are 0
+    float weightedSum;  // sum of bin index * amplitude (centroid numerator, in bins)
+    float flux;         // sum of squared differences from the previous window
+    float positiveFlux; // flux of the bins that increased in amplitude
+    float negativeFlux; // flux of the bins that decreased in amplitude
+    float entropy;      // normalized (0-1) spectral entropy
+};
+
+/**
+ * Calculate several statistics of a spectrum over a bin range in one pass.
+ *
+ * Each bin is read from memory once, instead of once per statistic as when
+ * calling the individual helpers. The pass is the stats kernel of
+ * get_kernels(), which keeps the maximum and its index in separate vector
+ * lanes and reduces them at the end. The flux statistics are only computed
+ * if prevWindow is not NULL, and the entropy only if withEntropy is set, as
+ * its per-bin log2() dominates the cost. Statistics that are not computed
+ * are 0.
+ *
+ * The entropy matches entropy(): with p = a / total over the non-empty bins,
+ *   -sum(p * log2(p)) = log2(total) - sum(a * log2(a)) / total
+ * so only sum(a * log2(a)) needs to be accumulated per bin, in a second loop
+ * over the range which is still in L1 cache. A silent range has an entropy
+ * of 0.
+ *
+ * @param currWindow The current input spectrum data
+ * @param prevWindow The previous input spectrum data, may be NULL
+ * @param lowerBin The lower bin bound to analyze
+ * @param upperBin The upper bin bound to analyze (exclusive)
+ * @param stats Output, the calculated statistics
+ * @param withEntropy Whether to calculate the entropy
+ */
+inline void spectral_stats(const float* currWindow, const float* prevWindow,
+    int lowerBin, int upperBin, SpectralStats& stats, bool withEntropy = false)
+{
+    int numBins = upperBin - lowerBin;
+
+    KernelStats pass;
+    get_kernels().stats(currWindow + lowerBin, prevWindow != NULL ? prevWindow + lowerBin : NULL,
+        numBins, &pass);
+
+    // the kernel indexes bins from the start of the range
+    stats.sum          = pass.sum;
+    stats.energy       = pass.energy;
+    stats.max          = pass.max;
+    stats.argmax       = pass.argmax >= 0 ? pass.argmax + lowerBin : -1;
+    stats.weightedSum  = pass.weightedSum + float(lowerBin) * pass.sum;
+    stats.positiveFlux = pass.positiveFlux;
+    stats.negativeFlux = pass.negativeFlux;
+    stats.flux         = pass.positiveFlux + pass.negativeFlux;
+
+    stats.entropy = 0.0f;
+    if (withEntropy && stats.sum > 0.0f && numBins > 1) {
+        // empty bins do not contribute, as lim a->0 of a * log2(a) is 0
+        float info = 0.0f;
+        for (int i = lowerBin; i < upperBin; ++i) {
+            float a = currWindow[i];
+            info += a > 0.0f ? a * entropy_log2(a) : 0.0f;
+        }
+        float entropy = log2f(stats.sum) - info / stats.sum;
+
+        // normalize the entropy value by the log2 of the number of bins, which
+        // is the maximum possible entropy value.
+        stats.entropy = entropy / log2f(numBins);
     }
+}
+
+//============================================================================
+// FIXED SIZE KERNELS
+//============================================================================
+
+// The kernels below take their bin count as a template parameter, for use by
+// the fixed modules (see AnalysisContext.h). Their loops have constant trip
+// counts and keep independent partial results per lane, so the compiler is
+// free to unroll and vectorize them without reassociating float math itself.
+
+const int FIXED_LANES = 8;
 
-    float freqWidth     = (float)WINDOW_SIZE / (float)SAMPLE_RATE;
-    int   lowerBinBound = round(lowerFreq * freqWidth);
-    int   upperBinBound = round(upperFreq * freqWidth);
+/**
+ * Calculate the sum of N contiguous bins.
+ */
+template <int N>
+inline float fixed_sum(const float* data)
+{
+    float partial[FIXED_LANES] = { 0 };
+    for (int i = 0; i + FIXED_LANES <= N; i += FIXED_LANES) {
+        for (int l = 0; l < FIXED_LANES; ++l) {
+            partial[l] += data[i + l];
+        }
+    }
+    for (int i = N - (N % FIXED_LANES); i < N; ++i) {
+        partial[0] += data[i];
+    }
 
     float sum = 0.0f;
-    for (int i = lowerBinBound; i < upperBinBound; ++i) {
-        sum += windowData[i];
+    for (int l = 0; l < FIXED_LANES; ++l) {
+        sum += partial[l];
+    }
+    return sum;
+}
+
+/**
+ * Calculate the sum of bin index * amplitude of N contiguous bins starting
+ * at bin Lower.
+ */
+template <int Lower, int N>
+inline float fixed_weighted_sum(const float* windowData)
+{
+    float partial[FIXED_LANES] = { 0 };
+    for (int i = 0; i + FIXED_LANES <= N; i += FIXED_LANES) {
+        for (int l = 0; l < FIXED_LANES; ++l) {
+            partial[l] += float(Lower + i + l) * windowData[Lower + i + l];
+        }
+    }
+    for (int i = N - (N % FIXED_LANES); i < N; ++i) {
+        partial[0] += float(Lower + i) * windowData[Lower + i];
     }
 
+    float sum = 0.0f;
+    for (int l = 0; l < FIXED_LANES; ++l) {
+        sum += partial[l];
+    }
     return sum;
 }
 
+/**
+ * Find the maximum amplitude of N contiguous bins, 0 if all are negative.
+ */
+template <int N>
+inline float fixed_max(const float* data)
+{
+    float partial[FIXED_LANES] = { 0 };
+    for (int i = 0; i + FIXED_LANES <= N; i += FIXED_LANES) {
+        for (int l = 0; l < FIXED_LANES; ++l) {
+            partial[l] = data[i + l] > partial[l] ? data[i + l] : partial[l];
+        }
+    }
+    for (int i = N - (N % FIXED_LANES); i < N; ++i) {
+        partial[0] = data[i] > partial[0] ? data[i] : partial[0];
+    }
+
+    float maxVal = 0.0f;
+    for (int l = 0; l < FIXED_LANES; ++l) {
+        maxVal = partial[l] > maxVal ? partial[l] : maxVal;
+    }
+    return maxVal;
+}
+
+/**
+ * Calculate the total amplitude sum of the spectrum over a frequency range.
+ *
+ * @param windowData The input spectrum data
+ * @param lowerFreq The lower frequency bound to analyze
+ * @param upperFreq The upper frequency bound to analyze
+ */
+inline float sum(const float* windowData, int lowerFreq, int upperFreq)
+{
+    int lowerBinBound, upperBinBound;
+    if (!freq_to_bin_range(lowerFreq, upperFreq, lowerBinBound, upperBinBound)) {
+        return -1;
+    }
+
+    return get_kernels().sum(windowData + lowerBinBound, upperBinBound - lowerBinBound);
+}
+
 /**
  * Calculate the mean amplitude of the spectrum over a frequency range.
  *
@@ -44,15 +266,12 @@ inline float sum(const float* windowData, int lowerFreq, int upperFreq)
  */
 inline float mean(const float* windowData, int lowerFreq, int upperFreq)
 {
-    if (lowerFreq < 0 || upperFreq > SAMPLE_RATE >> 1 || lowerFreq > upperFreq) {
+    int lowerBinBound, upperBinBound;
+    if (!freq_to_bin_range(lowerFreq, upperFreq, lowerBinBound, upperBinBound)) {
         return -1;
     }
 
-    float freqWidth     = (float)WINDOW_SIZE / (float)SAMPLE_RATE;
-    int   lowerBinBound = round(lowerFreq * freqWidth);
-    int   upperBinBound = round(upperFreq * freqWidth);
-
-    float t = sum(windowData, lowerFreq, upperFreq);
+    float t = get_kernels().sum(windowData + lowerBinBound, upperBinBound - lowerBinBound);
     return t / float(upperBinBound - lowerBinBound);
 }
 
@@ -65,21 +284,13 @@ inline float mean(const float* windowData, int lowerFreq, int upperFreq)
  */
 inline float max(const float* windowData, int lowerFreq, int upperFreq)
 {
-    if (lowerFreq < 0 || upperFreq > SAMPLE_RATE >> 1 || lowerFreq > upperFreq) {
+    int lowerBinBound, upperBinBound;
+    if (!freq_to_bin_range(lowerFreq, upperFreq, lowerBinBound, upperBinBound)) {
         return -1;
     }
 
-    float freqWidth     = (float)WINDOW_SIZE / (float)SAMPLE_RATE;
-    int   lowerBinBound = round(lowerFreq * freqWidth);
-    int   upperBinBound = round(upperFreq * freqWidth);
-
-    float maxVal = 0.0f;
-    for (int i = lowerBinBound; i < upperBinBound; ++i) {
-        if (windowData[i] > maxVal) {
-            maxVal = windowData[i];
-        }
-    }
-    return maxVal;
+    int argmax;
+    return get_kernels().max(windowData + lowerBinBound, upperBinBound - lowerBinBound, &argmax);
 }
 
 /**
@@ -93,20 +304,12 @@ inline float max(const float* windowData, int lowerFreq, int upperFreq)
  */
 inline float energy(const float* windowData, int lowerFreq, int upperFreq)
 {
-    if (lowerFreq < 0 || upperFreq > SAMPLE_RATE >> 1 || lowerFreq > upperFreq) {
+    int lowerBinBound, upperBinBound;
+    if (!freq_to_bin_range(lowerFreq, upperFreq, lowerBinBound, upperBinBound)) {
         return -1;
     }
 
-    float freqWidth     = (float)WINDOW_SIZE / (float)SAMPLE_RATE;
-    int   lowerBinBound = round(lowerFreq * freqWidth);
-    int   upperBinBound = round(upperFreq * freqWidth);
-
-    float energy = 0.;
-    for (int i = lowerBinBound; i < upperBinBound; ++i) {
-        energy += windowData[i] * windowData[i];
-    }
-
-    return energy;
+    return get_kernels().energy(windowData + lowerBinBound, upperBinBound - lowerBinBound);
 }
 
 /**
@@ -128,41 +331,30 @@ inline float energy(const float* windowData, int lowerFreq, int upperFreq)
  */
 inline float entropy(const float* windowData, int lowerFreq, int upperFreq)
 {
-    if (lowerFreq < 0 || upperFreq > SAMPLE_RATE >> 1 || lowerFreq > upperFreq) {
+    int lowerBinBound, upperBinBound;
+    if (!freq_to_bin_range(lowerFreq, upperFreq, lowerBinBound, upperBinBound)) {
         return -1;
     }
 
-    float freqWidth     = (float)WINDOW_SIZE / (float)SAMPLE_RATE;
-    int   lowerBinBound = round(lowerFreq * freqWidth);
-    int   upperBinBound = round(upperFreq * freqWidth);
-
-    float entropy  = 0.;
-    float totalAmp = sum(windowData, lowerFreq, upperFreq);
-    for (int i = lowerBinBound; i < upperBinBound; ++i) {
-        // p is the spectral density of the bin, or the percent of the total
-        // amplitude it containts. For calculating entropy, it is helpful to
-        // think of this as the probability of the bin containing energy. The
-        // small offsets are to avoid division by or log of zero errors.
-        float p = (windowData[i] + 1e-12) / (totalAmp + 1e-10);
-        //
-        // Calculate the entropy addition of each bin:
-        //
-        // -log(p) is the 'self-information' of the bin. It is a measure of how
-        // surprising it is to see energy in that bin. If p is close to 1, then
-        // it is not surprising at all to see energy there, but if it is small
-        // it this value will be greater, meaning it is very suprising to see
-        // energy there. This makes sense as p was calculated as the percent of
-        // the total energy that the bin contains.
-        //
-        // We weight this 'self-information' value with the actual percent of
-        // the total amplitude that bin has so that bins with very little energy
-        // do not dominate the entropy value.
-        entropy += p * -(log2(p));
-    }
-
-    // normalize the entropy value by the log2 of the number of bins, which is
-    // the maximum possible entropy value.
-    return entropy / log2(upperBinBound - lowerBinBound);
+    // The entropy is computed in a single pass by spectral_stats(). For each
+    // bin, p is the spectral density of the bin, or the percent of the total
+    // amplitude it containts. For calculating entropy, it is helpful to think
+    // of this as the probability of the bin containing energy.
+    //
+    // -log(p) is the 'self-information' of the bin. It is a measure of how
+    // surprising it is to see energy in that bin. If p is close to 1, then
+    // it is not surprising at all to see energy there, but if it is small
+    // it this value will be greater, meaning it is very suprising to see
+    // energy there. This makes sense as p was calculated as the percent of
+    // the total energy that the bin contains.
+    //
+    // We weight this 'self-information' value with the actual percent of
+    // the total amplitude that bin has so that bins with very little energy
+    // do not dominate the entropy value. The result is normalized by the
+    // log2 of the number of bins, which is the maximum possible entropy value.
+    SpectralStats stats;
+    spectral_stats(windowData, NULL, lowerBinBound, upperBinBound, stats, true);
+    return stats.entropy;
 }
 
 // Per-bin delta amplitudes between current and previous window
@@ -193,20 +385,13 @@ inline float entropy(const float* windowData, int lowerFreq, int upperFreq)
 inline float flux(const float* currWindow, const float* prevWindow,
     int lowerFreq, int upperFreq)
 {
-    if (lowerFreq < 0 || upperFreq > SAMPLE_RATE >> 1 || lowerFreq > upperFreq) {
+    int lowerBinBound, upperBinBound;
+    if (!freq_to_bin_range(lowerFreq, upperFreq, lowerBinBound, upperBinBound)) {
         return -1;
     }
 
-    float freqWidth     = (float)WINDOW_SIZE / (float)SAMPLE_RATE;
-    int   lowerBinBound = round(lowerFreq * freqWidth);
-    int   upperBinBound = round(upperFreq * freqWidth);
-
-    float flux = 0.0f;
-    for (int i = lowerBinBound; i < upperBinBound; ++i) {
-        flux += pow(currWindow[i] - prevWindow[i], 2);
-    }
-
-    return flux;
+    return get_kernels().flux(currWindow + lowerBinBound, prevWindow + lowerBinBound,
+        upperBinBound - lowerBinBound);
 }
 
 /**
@@ -225,24 +410,13 @@ inline float flux(const float* currWindow, const float* prevWindow,
 inline float positive_flux(const float* currWindow, const float* prevWindow,
     int lowerFreq, int upperFreq)
 {
-    if (lowerFreq < 0 || upperFreq > SAMPLE_RATE >> 1 || lowerFreq > upperFreq) {
+    int lowerBinBound, upperBinBound;
+    if (!freq_to_bin_range(lowerFreq, upperFreq, lowerBinBound, upperBinBound)) {
         return -1;
     }
 
-    float freqWidth     = (float)WINDOW_SIZE / (float)SAMPLE_RATE;
-    int   lowerBinBound = round(lowerFreq * freqWidth);
-    int   upperBinBound = round(upperFreq * freqWidth);
-
-    float flux = 0.0f;
-    for (int i = lowerBinBound; i < upperBinBound; ++i) {
-        float pos_diff = currWindow[i] - prevWindow[i];
-        if (pos_diff < 0) {
-            pos_diff = 0;
-        }
-        flux += pow(pos_diff, 2);
-    }
-
-    return flux;
+    return get_kernels().positive_flux(currWindow + lowerBinBound, prevWindow + lowerBinBound,
+        upperBinBound - lowerBinBound);
 }
 
 /**
@@ -260,24 +434,13 @@ inline float positive_flux(const float* currWindow, const float* prevWindow,
 inline float negative_flux(const float* currWindow, const float* prevWindow,
     int lowerFreq, int upperFreq)
 {
-    if (lowerFreq < 0 || upperFreq > SAMPLE_RATE >> 1 || lowerFreq > upperFreq) {
+    int lowerBinBound, upperBinBound;
+    if (!freq_to_bin_range(lowerFreq, upperFreq, lowerBinBound, upperBinBound)) {
         return -1;
     }
 
-    float freqWidth     = (float)WINDOW_SIZE / (float)SAMPLE_RATE;
-    int   lowerBinBound = round(lowerFreq * freqWidth);
-    int   upperBinBound = round(upperFreq * freqWidth);
-
-    float flux = 0.0f;
-    for (int i = lowerBinBound; i < upperBinBound; ++i) {
-        float neg_diff = currWindow[i] - prevWindow[i];
-        if (neg_diff > 0) {
-            neg_diff = 0;
-        }
-        flux += pow(neg_diff, 2);
-    }
-
-    return flux;
+    return get_kernels().negative_flux(currWindow + lowerBinBound, prevWindow + lowerBinBound,
+        upperBinBound - lowerBinBound);
 }
 
 /**
@@ -295,10 +458,34 @@ inline float negative_flux(const float* currWindow, const float* prevWindow,
 inline void smooth_window_over_time(const float* windowData, float* smoothedData,
     float smoothingFactor = 0.05)
 {
-    for (int i = 0; i < (WINDOW_SIZE >> 1); ++i) {
-        float new_weight = smoothingFactor * windowData[i];
-        float old_weight = (1 - smoothingFactor) * smoothedData[i];
-        smoothedData[i]  = new_weight + old_weight;
+    get_kernels().smooth(windowData, smoothedData, WINDOW_SIZE >> 1, smoothingFactor);
+}
+
+/**
+ * Calculates the mean of each frequency bin over a contiguous history of
+ * windows, e.g. the view of a mirrored Spectrogram.
+ *
+ * The history is read window by window, in memory order.
+ *
+ * @param historyData The windows, each WINDOW_SIZE / 2 bins, back to back.
+ * @param numWindows The number of windows in the history.
+ * @param meanData Output array for the mean spectrum, WINDOW_SIZE / 2 bins.
+ */
+inline void mean_over_time(const float* historyData, int numWindows, float* meanData)
+{
+    const int numBins = WINDOW_SIZE >> 1;
+
+    memcpy(meanData, historyData, numBins * sizeof(float));
+    for (int w = 1; w < numWindows; w++) {
+        const float* windowData = historyData + w * numBins;
+        for (int i = 0; i < numBins; i++) {
+            meanData[i] += windowData[i];
+        }
+    }
+
+    const float scale = 1.0f / numWindows;
+    for (int i = 0; i < numBins; i++) {
+        meanData[i] *= scale;
     }
 }
 
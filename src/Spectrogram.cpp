@@ -1,65 +1,479 @@
 #include "Spectrogram.h"
 
+#include "Platform.h"
+#include "SpectralTools.h"
+
+// 8-bit log codes: code c > 0 is 2^((c - 255) / 16) times the largest bin of
+// its window, bins below half a step under code 1 are stored as 0
+#define LOG8_STEPS_PER_OCTAVE 16
+#define LOG8_FLOOR            1.6283e-5f // 2^(-254.5 / 16)
+
+// decoded value of each 8-bit log code, relative to the largest bin
+struct Log8Table {
+    float values[256];
+
+    Log8Table()
+    {
+        values[0] = 0.0f;
+        for (int c = 1; c < 256; c++) {
+            values[c] = exp2f(float(c - 255) / LOG8_STEPS_PER_OCTAVE);
+        }
+    }
+};
+
+// the table is filled on first use, which is thread-safe
+static const float* log8_table()
+{
+    static const Log8Table table;
+    return table.values;
+}
+
+// converts a value in [0, 1] to half precision, rounding to nearest even
+static uint16_t float_to_half(float value)
+{
+    // below the smallest normal half, 2^-14, halves are multiples of 2^-24
+    if (value < 6.103515625e-5f) {
+        return (uint16_t)(value * 16777216.0f + 0.5f);
+    }
+
+    // rebias the exponent from 127 to 15 and round away 13 mantissa bits
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits -= (127 - 15) << 23;
+    return (uint16_t)((bits + 0x0fff + ((bits >> 13) & 1)) >> 13);
+}
+
+static float half_to_float(uint16_t half)
+{
+    if (half < 0x0400) {
+        return float(half) * 5.9604644775390625e-8f; // 2^-24
+    }
+
+    uint32_t bits = ((uint32_t)half << 13) + ((127 - 15) << 23);
+    float    value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
 // make default to two windows, allow resizing
-Spectrogram::Spectrogram()
+template <typename T>
+BasicSpectrogram<T>::BasicSpectrogram()
 {
     this->buffer     = NULL;
     this->numWindows = 0;
     this->numBins    = 0;
     this->currIndex  = 0;
+    this->frameCount = 0;
+    this->ownsBuffer = false;
+    this->mirrored   = false;
+    this->hopSize    = WINDOW_SIZE;
+    this->hopLag     = 1;
 };
 
-Spectrogram::Spectrogram(const uint16_t numWindows)
+template <typename T>
+BasicSpectrogram<T>::BasicSpectrogram(const uint16_t numWindows, const bool mirrored)
 {
     uint16_t numBins = WINDOW_SIZE >> 1;
-    this->buffer     = new float[numWindows * numBins];
+    // a mirrored ring holds a second copy of every window
+    this->buffer     = new T[(mirrored ? 2 : 1) * numWindows * numBins];
     this->numWindows = numWindows;
     this->numBins    = numBins;
     this->currIndex  = 0;
+    this->frameCount = 0;
+    this->ownsBuffer = true;
+    this->mirrored   = mirrored;
+    this->hopSize    = WINDOW_SIZE;
+    this->hopLag     = 1;
 }
 
-Spectrogram::~Spectrogram()
+template <typename T>
+BasicSpectrogram<T>::BasicSpectrogram(T* buffer, const uint16_t numWindows, const bool mirrored)
 {
-    delete[] this->buffer;
+    this->buffer     = buffer;
+    this->numWindows = numWindows;
+    this->numBins    = WINDOW_SIZE >> 1;
+    this->currIndex  = 0;
+    this->frameCount = 0;
+    this->ownsBuffer = false;
+    this->mirrored   = mirrored;
+    this->hopSize    = WINDOW_SIZE;
+    this->hopLag     = 1;
+}
+
+template <typename T>
+BasicSpectrogram<T>::~BasicSpectrogram()
+{
+    if (this->ownsBuffer) {
+        delete[] this->buffer;
+    }
     this->buffer = NULL;
 };
 
-float* Spectrogram::getWindowAt(int relativeIndex) const
+template <typename T>
+T* BasicSpectrogram<T>::getWindowAt(int relativeIndex) const
 {
-    // ensure that modulus math will work for negative values:
-    while (relativeIndex < 0) {
-        relativeIndex += this->numWindows;
+    // a single modulus, corrected for negative values
+    int index = (this->currIndex + relativeIndex) % this->numWindows;
+    if (index < 0) {
+        index += this->numWindows;
     }
-    uint16_t index = (this->currIndex + relativeIndex) % this->numWindows;
     return this->buffer + (index * this->numBins);
 };
 
-float* Spectrogram::getCurrentWindow() const
+template <typename T>
+T* BasicSpectrogram<T>::getCurrentWindow() const
 {
     return this->buffer + (this->currIndex * this->numBins);
 };
 
-float* Spectrogram::getPreviousWindow() const
+template <typename T>
+T* BasicSpectrogram<T>::getPreviousWindow() const
 {
     uint16_t prev_index = (this->numWindows + this->currIndex - 1) % this->numWindows;
     return this->buffer + (prev_index * this->numBins);
 };
 
-void Spectrogram::pushWindow(const float* data)
+template <typename T>
+void BasicSpectrogram<T>::setHopSize(const uint16_t hopSize)
+{
+    if (hopSize == 0 || hopSize > WINDOW_SIZE) {
+        Serial.printf("Error: hop size must be between 1 and WINDOW_SIZE.\n");
+        return;
+    }
+
+    // windows start hopSize samples apart, so the last window that does not
+    // overlap the current one is WINDOW_SIZE / hopSize windows back, rounded up
+    uint16_t lag = (WINDOW_SIZE + hopSize - 1) / hopSize;
+    if (lag >= this->numWindows) {
+        Serial.printf("Error: a hop size of %d needs a Spectrogram of %d windows or more.\n",
+            hopSize, lag + 1);
+        return;
+    }
+
+    this->hopSize = hopSize;
+    this->hopLag  = lag;
+};
+
+template <typename T>
+BasicSpectrogramHistory<T> BasicSpectrogram<T>::getHistory() const
+{
+    BasicSpectrogramHistory<T> history;
+    history.numWindows = this->numWindows;
+    history.numBins    = this->numBins;
+    history.data       = NULL;
+
+    // the oldest window follows the current one, and the mirror keeps all
+    // windows after it contiguous
+    if (this->mirrored) {
+        history.data = this->buffer + ((this->currIndex + 1) * this->numBins);
+    }
+    return history;
+};
+
+template <typename T>
+void BasicSpectrogram<T>::pushWindow(const T* data)
+{
+    memcpy(this->acquireWindow(), data, this->numBins * sizeof(T));
+    this->commitWindow();
+};
+
+template <typename T>
+T* BasicSpectrogram<T>::acquireWindow() const
+{
+    uint16_t next_index = (this->currIndex + 1) % this->numWindows;
+    return this->buffer + (next_index * this->numBins);
+};
+
+template <typename T>
+void BasicSpectrogram<T>::commitWindow()
 {
     this->currIndex++;
     if (this->currIndex == this->numWindows) {
         this->currIndex = 0;
     }
 
-    float* windowBuffer = this->buffer + (this->currIndex * this->numBins);
-    memcpy(windowBuffer, data, this->numBins * sizeof(float));
+    // keep the mirror in sync with the new window
+    if (this->mirrored) {
+        T* windowBuffer = this->buffer + (this->currIndex * this->numBins);
+        memcpy(windowBuffer + (this->numWindows * this->numBins), windowBuffer,
+            this->numBins * sizeof(T));
+    }
+
+    // a new frame implicitly invalidates cached features
+    this->frameCount++;
 };
 
-void Spectrogram::clearBuffer()
+template <typename T>
+void BasicSpectrogram<T>::clearBuffer()
 {
-    for (int i = 0; i < numWindows * numBins; i++) {
+    int bufferSize = (this->mirrored ? 2 : 1) * numWindows * numBins;
+    for (int i = 0; i < bufferSize; i++) {
         buffer[i] = 0;
     }
     this->currIndex = 0;
 };
+
+// the bin types of the float and fixed-point analysis paths
+template class BasicSpectrogram<float>;
+template class BasicSpectrogram<int16_t>;
+
+Spectrogram::Spectrogram()
+    : BasicSpectrogram<float>()
+{
+    this->features = NULL;
+
+    this->prefixSums    = NULL;
+    this->prefixSquares = NULL;
+
+    this->history       = NULL;
+    this->historyScales = NULL;
+    this->historyLength = 0;
+    this->historyIndex  = 0;
+    this->historyFormat = HISTORY_FLOAT16;
+
+    this->shared = false;
+};
+
+Spectrogram::Spectrogram(const uint16_t numWindows, const bool mirrored)
+    : BasicSpectrogram<float>(numWindows, mirrored)
+{
+    this->features = new FeatureCache(this);
+
+    this->prefixSums    = NULL;
+    this->prefixSquares = NULL;
+
+    this->history       = NULL;
+    this->historyScales = NULL;
+    this->historyLength = 0;
+    this->historyIndex  = 0;
+    this->historyFormat = HISTORY_FLOAT16;
+
+    this->shared = false;
+}
+
+Spectrogram::Spectrogram(float* buffer, const uint16_t numWindows, const bool mirrored)
+    : BasicSpectrogram<float>(buffer, numWindows, mirrored)
+{
+    this->features = new FeatureCache(this);
+
+    this->prefixSums    = NULL;
+    this->prefixSquares = NULL;
+
+    this->history       = NULL;
+    this->historyScales = NULL;
+    this->historyLength = 0;
+    this->historyIndex  = 0;
+    this->historyFormat = HISTORY_FLOAT16;
+
+    this->shared = false;
+}
+
+Spectrogram::~Spectrogram()
+{
+    delete this->features;
+    this->features = NULL;
+
+    delete[] this->prefixSums;
+    delete[] this->prefixSquares;
+    this->prefixSums    = NULL;
+    this->prefixSquares = NULL;
+
+    delete[] this->history;
+    delete[] this->historyScales;
+    this->history       = NULL;
+    this->historyScales = NULL;
+};
+
+void Spectrogram::enablePrefixSums()
+{
+    if (this->prefixSums != NULL || this->buffer == NULL) {
+        return;
+    }
+
+    int rowSize         = this->numBins + 1;
+    this->prefixSums    = new float[this->numWindows * rowSize];
+    this->prefixSquares = new float[this->numWindows * rowSize];
+    for (uint16_t i = 0; i < this->numWindows; i++) {
+        indexWindow(i);
+    }
+};
+
+const float* Spectrogram::getPrefixSums() const
+{
+    if (this->prefixSums == NULL) {
+        return NULL;
+    }
+    return this->prefixSums + (this->currIndex * (this->numBins + 1));
+};
+
+const float* Spectrogram::getPrefixSquares() const
+{
+    if (this->prefixSquares == NULL) {
+        return NULL;
+    }
+    return this->prefixSquares + (this->currIndex * (this->numBins + 1));
+};
+
+void Spectrogram::indexWindow(uint16_t index)
+{
+    const float* windowData = this->buffer + (index * this->numBins);
+    float*       sums       = this->prefixSums + (index * (this->numBins + 1));
+    float*       squares    = this->prefixSquares + (index * (this->numBins + 1));
+
+    float sum    = 0.0f;
+    float energy = 0.0f;
+    sums[0]      = 0.0f;
+    squares[0]   = 0.0f;
+    for (int i = 0; i < this->numBins; i++) {
+        float amp = windowData[i];
+        sum += amp;
+        energy += amp * amp;
+        sums[i + 1]    = sum;
+        squares[i + 1] = energy;
+    }
+};
+
+void Spectrogram::enableCompressedHistory(const uint16_t historyLength, const HistoryFormat format)
+{
+    if (this->history != NULL || this->buffer == NULL || historyLength == 0) {
+        return;
+    }
+
+    int bytesPerBin     = (format == HISTORY_LOG8) ? 1 : 2;
+    this->history       = new uint8_t[historyLength * this->numBins * bytesPerBin];
+    this->historyScales = new float[historyLength];
+    this->historyLength = historyLength;
+    this->historyIndex  = 0;
+    this->historyFormat = format;
+    memset(this->history, 0, historyLength * this->numBins * bytesPerBin);
+    memset(this->historyScales, 0, historyLength * sizeof(float));
+
+    // the windows already held, from the current one back
+    int numHeld = min(this->numWindows, historyLength);
+    for (int i = 0; i < numHeld; i++) {
+        uint16_t index = (historyLength - i) % historyLength;
+        compressWindow(index, this->getWindowAt(-i));
+    }
+};
+
+uint16_t Spectrogram::getHistoryLength() const
+{
+    return this->historyLength > this->numWindows ? this->historyLength : this->numWindows;
+};
+
+void Spectrogram::compressWindow(uint16_t index, const float* data)
+{
+    float maxVal = 0.0f;
+    for (int i = 0; i < this->numBins; i++) {
+        maxVal = data[i] > maxVal ? data[i] : maxVal;
+    }
+
+    // a silent (or denormal) window is stored as all zeros
+    if (!(maxVal >= 1.17549435e-38f)) {
+        maxVal = 0.0f;
+    }
+    this->historyScales[index] = maxVal;
+
+    if (this->historyFormat == HISTORY_LOG8) {
+        uint8_t* codes = this->history + (index * this->numBins);
+        if (maxVal == 0.0f) {
+            memset(codes, 0, this->numBins);
+            return;
+        }
+
+        // code = 255 + 16 * log2(amp / maxVal), rounded
+        float minAmp = maxVal * LOG8_FLOOR;
+        float bias   = 255.5f - LOG8_STEPS_PER_OCTAVE * AudioPrism::fast_log2(maxVal);
+        for (int i = 0; i < this->numBins; i++) {
+            float amp = data[i];
+            if (!(amp > minAmp)) {
+                codes[i] = 0;
+                continue;
+            }
+            int code = int(LOG8_STEPS_PER_OCTAVE * AudioPrism::fast_log2(amp) + bias);
+            codes[i] = code < 1 ? 1 : (code > 255 ? 255 : code);
+        }
+    } else {
+        uint16_t* halves = (uint16_t*)this->history + (index * this->numBins);
+        float     scale  = maxVal > 0.0f ? 1.0f / maxVal : 0.0f;
+        for (int i = 0; i < this->numBins; i++) {
+            float value = data[i] * scale;
+            halves[i]   = float_to_half(value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f);
+        }
+    }
+};
+
+bool Spectrogram::decodeWindow(int relativeIndex, float* data) const
+{
+    if (relativeIndex > 0 || -relativeIndex >= this->getHistoryLength()) {
+        return false;
+    }
+
+    // recent windows are still held in full precision
+    if (-relativeIndex < this->numWindows) {
+        memcpy(data, this->getWindowAt(relativeIndex), this->numBins * sizeof(float));
+        return true;
+    }
+
+    uint16_t index = (this->historyIndex + relativeIndex % this->historyLength + this->historyLength)
+        % this->historyLength;
+    float scale = this->historyScales[index];
+
+    if (this->historyFormat == HISTORY_LOG8) {
+        const float*   table = log8_table();
+        const uint8_t* codes = this->history + (index * this->numBins);
+        for (int i = 0; i < this->numBins; i++) {
+            data[i] = table[codes[i]] * scale;
+        }
+    } else {
+        const uint16_t* halves = (const uint16_t*)this->history + (index * this->numBins);
+        for (int i = 0; i < this->numBins; i++) {
+            data[i] = half_to_float(halves[i]) * scale;
+        }
+    }
+    return true;
+};
+
+void Spectrogram::pushWindow(const float* data)
+{
+    memcpy(this->acquireWindow(), data, this->numBins * sizeof(float));
+    this->commitWindow();
+};
+
+void Spectrogram::commitWindow()
+{
+    BasicSpectrogram<float>::commitWindow();
+
+    if (this->prefixSums != NULL) {
+        indexWindow(this->currIndex);
+    }
+
+    if (this->history != NULL) {
+        this->historyIndex = (this->historyIndex + 1) % this->historyLength;
+        compressWindow(this->historyIndex, this->getCurrentWindow());
+    }
+};
+
+void Spectrogram::clearBuffer()
+{
+    BasicSpectrogram<float>::clearBuffer();
+
+    // the rows of silent windows are all zeros
+    if (this->prefixSums != NULL) {
+        int prefixSize = numWindows * (numBins + 1);
+        memset(this->prefixSums, 0, prefixSize * sizeof(float));
+        memset(this->prefixSquares, 0, prefixSize * sizeof(float));
+    }
+
+    // silent windows are stored as all zeros
+    if (this->history != NULL) {
+        int bytesPerBin = (this->historyFormat == HISTORY_LOG8) ? 1 : 2;
+        memset(this->history, 0, this->historyLength * numBins * bytesPerBin);
+        memset(this->historyScales, 0, this->historyLength * sizeof(float));
+        this->historyIndex = 0;
+    }
+
+    if (this->features != NULL) {
+        this->features->invalidate();
+    }
+};
@@ -10,22 +10,58 @@
 #include <cstring>
 
 #include "Config.h"
+#include "FeatureCache.h"
+
+/**
+ * A read-only view of the windows held by a mirrored Spectrogram.
+ *
+ * Windows are stored contiguously from oldest to newest, each numBins long:
+ * bin i of window w is at data[w * numBins + i], and the current window is
+ * window numWindows - 1. The view is invalidated by the next pushed window.
+ */
+template <typename T>
+struct BasicSpectrogramHistory {
+    const T* data;
+    uint16_t numWindows;
+    uint16_t numBins;
+
+    const T* operator[](int window) const { return this->data + window * this->numBins; };
+};
+
+typedef BasicSpectrogramHistory<float> SpectrogramHistory;
 
 /**
  * Spectrogram holds the frequency domain data over multiple time windows.
  *
  * This class implements a circular buffer to store multiple windows of
  * frequency domain data. Pushing new windows of data will overwrite the oldest
- * window stored. It requires the buffer data to be allocated by the user.
+ * window stored. The buffer is either allocated by the Spectrogram, or
+ * provided and owned by the user, e.g. to place it in a specific memory region.
+ *
+ * Windows can be pushed by copy with pushWindow(), or written in place: an
+ * FFT can write its magnitudes straight into the slot returned by
+ * acquireWindow(), which becomes the current window on commitWindow().
+ *
+ * A mirrored Spectrogram stores every window twice, in two back to back
+ * copies of the ring, so the last numWindows windows are always contiguous
+ * in memory (see getHistory()). This doubles the buffer size and the cost of
+ * pushing a window, in exchange for linear access along the time axis.
+ *
+ * The ring is templated on the type of its bins. Spectrogram is the float
+ * instantiation, extended with the FeatureCache and prefix sums the float
+ * modules use. SpectrogramQ15 holds Q15 fixed-point magnitudes for the
+ * integer analysis path of boards without an FPU (see FixedPoint.h). The
+ * ring is instantiated for float and int16_t (Q15) bins.
  */
-class Spectrogram {
+template <typename T>
+class BasicSpectrogram {
 public:
     /**
      * Creates an empty Spectrogram.
      *
      * Sets all values to 0 or NULL, allocates no memory for the data buffer.
      */
-    Spectrogram();
+    BasicSpectrogram();
 
     /**
      * Creates a Spectrogram with a buffer to hold data.
@@ -36,12 +72,29 @@ public:
      * Initializes the current index to 0.
      *
      * @param numWindows The number of time windows the Spectrogram holds.
+     * @param mirrored Whether to keep the windows contiguous, see getHistory().
      */
-    Spectrogram(const uint16_t numWindows);
+    BasicSpectrogram(const uint16_t numWindows, const bool mirrored = false);
 
-    ~Spectrogram();
+    /**
+     * Creates a Spectrogram over a buffer owned by the user.
+     *
+     * The buffer must hold numWindows * (WINDOW_SIZE / 2) bins, twice as
+     * many if mirrored, and outlive the Spectrogram, which never frees it. Its contents are used as is,
+     * call clearBuffer() to start from silence.
+     *
+     * Ex. float history[8][WINDOW_SIZE >> 1];
+     *     Spectrogram spectrogram = Spectrogram((float*)history, 8);
+     *
+     * @param buffer The buffer to hold the windows, in row-major order.
+     * @param numWindows The number of time windows the Spectrogram holds.
+     * @param mirrored Whether to keep the windows contiguous, see getHistory().
+     */
+    BasicSpectrogram(T* buffer, const uint16_t numWindows, const bool mirrored = false);
+
+    ~BasicSpectrogram();
 
-    float* getBuffer() const { return this->buffer; };
+    T* getBuffer() const { return this->buffer; };
 
     uint16_t getNumBins() const { return this->numBins; };
 
@@ -49,6 +102,16 @@ public:
 
     uint16_t getCurrentIndex() const { return this->currIndex; };
 
+    bool isMirrored() const { return this->mirrored; };
+
+    /**
+     * Gets the number of windows pushed since the Spectrogram was created.
+     *
+     * The count wraps around on overflow. It identifies the current frame,
+     * e.g. for caching values computed from it.
+     */
+    uint32_t getFrameCount() const { return this->frameCount; };
+
     /**
      * Gets the window data at an index relative to the current.
      *
@@ -58,21 +121,58 @@ public:
      * @param relativeIndex Index relative to the current.
      * @return Array of frequency domain data
      */
-    float* getWindowAt(int relativeIndex) const;
+    T* getWindowAt(int relativeIndex) const;
 
     /**
      * Gets the most recent Spectrogram window data.
      *
      * @return Array of frequency domain data
      */
-    float* getCurrentWindow() const;
+    T* getCurrentWindow() const;
 
     /**
      * Gets the previous Spectrogram window data.
      *
      * @return Array of frequency domain data
      */
-    float* getPreviousWindow() const;
+    T* getPreviousWindow() const;
+
+    /**
+     * Sets the number of samples between the starts of consecutive windows.
+     *
+     * Windows overlap when the hop size is smaller than WINDOW_SIZE (see
+     * STFT), in which case modules comparing windows over time (flux,
+     * DeltaAmplitudes, SalientFreqs) compare the current window with the
+     * last window that does not overlap it, so their outputs keep the scale
+     * of non-overlapping windows while being updated every hop. The
+     * Spectrogram must hold at least WINDOW_SIZE / hopSize + 1 windows.
+     *
+     * @param hopSize The hop size in samples, from 1 to WINDOW_SIZE.
+     */
+    void setHopSize(const uint16_t hopSize);
+
+    uint16_t getHopSize() const { return this->hopSize; };
+
+    /**
+     * Gets the most recent window that does not overlap the current one.
+     *
+     * This is the previous window unless the hop size is smaller than
+     * WINDOW_SIZE, see setHopSize().
+     *
+     * @return Array of frequency domain data
+     */
+    T* getNonOverlappingWindow() const { return this->getWindowAt(-this->hopLag); };
+
+    /**
+     * Gets the windows held by a mirrored Spectrogram as a contiguous view.
+     *
+     * Temporal analysis (e.g. per-bin statistics over time) can stream
+     * through the view linearly instead of looking up each window.
+     *
+     * @return View of all windows from oldest to newest, with NULL data if
+     * the Spectrogram is not mirrored.
+     */
+    BasicSpectrogramHistory<T> getHistory() const;
 
     /**
      * Pushes a new window to the Spectrogram.
@@ -83,18 +183,240 @@ public:
      *
      * @param data Pointer to the window's frequency domain data.
      */
-    void pushWindow(const float* data);
+    void pushWindow(const T* data);
+
+    /**
+     * Gets the slot the next window will be written to.
+     *
+     * The slot holds the oldest window, which is overwritten in place. Fill
+     * all bins of the slot, then call commitWindow() to make it the current
+     * window. Analysis must not run between the two calls. A mirrored
+     * Spectrogram copies the slot to its mirror on commit.
+     *
+     * @return Array of WINDOW_SIZE / 2 bins to write frequency domain data to
+     */
+    T* acquireWindow() const;
+
+    /**
+     * Makes the slot returned by acquireWindow() the current window.
+     *
+     * Equivalent to the end of pushWindow(), without copying any data.
+     */
+    void commitWindow();
 
     /**
      * Clears the Spectrogram's data buffer and resets the current index.
      */
     void clearBuffer();
 
-private:
-    float*   buffer;
+protected:
+    T*       buffer;
     uint16_t numWindows;
     uint16_t numBins;
     uint16_t currIndex;
+    uint32_t frameCount;
+    bool     ownsBuffer;
+    bool     mirrored;
+
+    // windows from the current window back to the last non-overlapping one
+    uint16_t hopSize;
+    uint16_t hopLag;
+};
+
+/**
+ * Storage formats of the compressed history of a Spectrogram, see
+ * Spectrogram::enableCompressedHistory().
+ */
+enum HistoryFormat {
+    HISTORY_FLOAT16, // half-precision, relative to the window's largest bin
+    HISTORY_LOG8     // 8-bit log2 magnitude in 1/16 octaves below the largest bin
+};
+
+/**
+ * Spectrogram holds the float windows analyzed by AudioPrism modules.
+ *
+ * On top of the ring of BasicSpectrogram, it owns the FeatureCache modules
+ * share their reductions through, and an optional prefix-sum index.
+ */
+class Spectrogram : public BasicSpectrogram<float> {
+public:
+    /**
+     * Creates an empty Spectrogram, see BasicSpectrogram.
+     */
+    Spectrogram();
+
+    /**
+     * Creates a Spectrogram with a buffer to hold data, see BasicSpectrogram.
+     */
+    Spectrogram(const uint16_t numWindows, const bool mirrored = false);
+
+    /**
+     * Creates a Spectrogram over a buffer owned by the user, see BasicSpectrogram.
+     */
+    Spectrogram(float* buffer, const uint16_t numWindows, const bool mirrored = false);
+
+    ~Spectrogram();
+
+    /**
+     * Gets the cache of per-frame features computed from this Spectrogram.
+     *
+     * Modules reading the same Spectrogram share the cache, so a reduction
+     * like the amplitude sum over a bin range is only computed once per frame.
+     *
+     * @return The feature cache, or NULL if the Spectrogram has no buffer.
+     */
+    FeatureCache* getFeatures() const { return this->features; };
+
+    /**
+     * Keeps a prefix-sum index alongside every window.
+     *
+     * Each window gets a row of numBins + 1 running sums of its amplitudes,
+     * and one of its squared amplitudes, updated when the window is
+     * committed. The sum or energy of any bin range is then two lookups
+     * (see getRangeSum()), which BreadSlicer and the FeatureCache use, so
+     * many overlapping ranges cost one pass over the bins per frame instead
+     * of one pass per range.
+     *
+     * The rows are accumulated in float, so range sums are accurate relative
+     * to the sum of the bins below the range rather than to the range itself.
+     * Call it once, before pushing windows; the windows already held are
+     * indexed when it is called.
+     */
+    void enablePrefixSums();
+
+    bool hasPrefixSums() const { return this->prefixSums != NULL; };
+
+    /**
+     * Gets the prefix sums of the current window: entry i is the sum of
+     * bins 0 to i - 1, so the sum of [lowerBin, upperBin) is
+     * prefix[upperBin] - prefix[lowerBin].
+     *
+     * @return numBins + 1 sums, or NULL if prefix sums are not enabled.
+     */
+    const float* getPrefixSums() const;
+
+    /**
+     * Gets the prefix sums of the squared amplitudes of the current window,
+     * like getPrefixSums().
+     */
+    const float* getPrefixSquares() const;
+
+    /**
+     * Gets the amplitude sum of the current window over [lowerBin, upperBin).
+     * Prefix sums must be enabled.
+     */
+    float getRangeSum(int lowerBin, int upperBin) const
+    {
+        const float* prefix = this->getPrefixSums();
+        return prefix[upperBin] - prefix[lowerBin];
+    };
+
+    /**
+     * Gets the energy (sum of squared amplitudes) of the current window over
+     * [lowerBin, upperBin). Prefix sums must be enabled.
+     */
+    float getRangeEnergy(int lowerBin, int upperBin) const
+    {
+        const float* prefix = this->getPrefixSquares();
+        return prefix[upperBin] - prefix[lowerBin];
+    };
+
+    /**
+     * Keeps a compressed copy of the last historyLength windows.
+     *
+     * Modules read the windows of the ring, which stay in full precision, so
+     * the ring only needs as many windows as they look back (2, or more with
+     * overlapping windows). Temporal features over a longer span read the
+     * compressed history with decodeWindow() instead. Each window is stored
+     * relative to its largest bin, with a float scale per window:
+     *
+     * - HISTORY_FLOAT16 keeps 2 bytes per bin, with a relative error below
+     *   5e-4 down to 84 dB below the largest bin.
+     * - HISTORY_LOG8 keeps 1 byte per bin, the log2 magnitude in steps of
+     *   1/16 octave over 96 dB below the largest bin, with a relative error
+     *   below 2.2%. Quieter bins decode to 0. Decoding is a table lookup.
+     *
+     * At 1024 bins, 64 windows of HISTORY_LOG8 take 64 KB, the size of 16
+     * float windows. Windows are compressed as they are committed, which
+     * costs about one pass over the bins. Call it once, before pushing
+     * windows; the windows already held are compressed when it is called.
+     *
+     * @param historyLength The number of windows to keep compressed.
+     * @param format The storage format of the compressed windows.
+     */
+    void enableCompressedHistory(const uint16_t historyLength, const HistoryFormat format);
+
+    bool hasCompressedHistory() const { return this->history != NULL; };
+
+    /**
+     * Gets the number of windows decodeWindow() can look back, the larger of
+     * the ring and compressed history lengths.
+     */
+    uint16_t getHistoryLength() const;
+
+    /**
+     * Decodes the window at an index relative to the current.
+     *
+     * Windows still held by the ring are copied in full precision, older
+     * ones are decoded from the compressed history.
+     *
+     * @param relativeIndex Index relative to the current, from 0 back to
+     * -(getHistoryLength() - 1).
+     * @param data Output, the numBins bins of the window.
+     * @return false if the window is not held.
+     */
+    bool decodeWindow(int relativeIndex, float* data) const;
+
+    /**
+     * Pushes a new window to the Spectrogram, see BasicSpectrogram::pushWindow().
+     */
+    void pushWindow(const float* data);
+
+    /**
+     * Makes the slot returned by acquireWindow() the current window, and
+     * indexes and compresses it if enabled.
+     */
+    void commitWindow();
+
+    /**
+     * Clears the Spectrogram's data buffer and resets the current index.
+     *
+     * Any cached features are invalidated.
+     */
+    void clearBuffer();
+
+    /**
+     * Checks if the Spectrogram is a SharedSpectrogram, whose windows are
+     * pushed by its producer thread only.
+     */
+    bool isShared() const { return this->shared; };
+
+protected:
+    FeatureCache* features;
+
+    // set by SharedSpectrogram, whose producer methods hide the ones above
+    bool shared;
+
+    // prefix-sum rows of numBins + 1 entries per window, NULL if disabled
+    float* prefixSums;
+    float* prefixSquares;
+
+    // recomputes the prefix-sum rows of the window in the given slot
+    void indexWindow(uint16_t index);
+
+    // compressed windows of historyLength slots, NULL if disabled, and the
+    // largest bin of each window they are relative to
+    uint8_t*      history;
+    float*        historyScales;
+    uint16_t      historyLength;
+    uint16_t      historyIndex;
+    HistoryFormat historyFormat;
+
+    // compresses a window into the given slot of the compressed history
+    void compressWindow(uint16_t index, const float* data);
 };
 
+// windows of Q15 fixed-point magnitudes, see FixedPoint.h
+typedef BasicSpectrogram<int16_t> SpectrogramQ15;
+
 #endif // SPECTROGRAM_H
@@ -0,0 +1,161 @@
+#include "ThreadPool.h"
+
+#ifndef ARDUINO
+
+ThreadPool::ThreadPool(int numThreads)
+{
+    if (numThreads <= 0) {
+        numThreads = std::thread::hardware_concurrency();
+    }
+    if (numThreads <= 0) {
+        numThreads = 1;
+    }
+
+    this->numThreads = numThreads;
+    this->nextQueue  = 0;
+    this->pending.store(0);
+    this->generation = 0;
+    this->stopping   = false;
+
+    for (int i = 0; i < numThreads; i++) {
+        Queue* queue = new Queue();
+        queue->head  = 0;
+        this->queues.push_back(queue);
+    }
+
+    // the thread calling wait() runs queue 0, workers the others
+    for (int i = 1; i < numThreads; i++) {
+        this->workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->stateLock);
+        this->stopping = true;
+    }
+    this->workAvailable.notify_all();
+
+    for (std::thread& worker : this->workers) {
+        worker.join();
+    }
+    for (Queue* queue : this->queues) {
+        delete queue;
+    }
+}
+
+void ThreadPool::submit(const Task* tasks, int numTasks)
+{
+    if (numTasks <= 0) {
+        return;
+    }
+
+    // count the tasks before any can finish
+    this->pending.fetch_add(numTasks);
+
+    for (int i = 0; i < numTasks; i++) {
+        Queue*                      queue = this->queues[this->nextQueue];
+        std::lock_guard<std::mutex> guard(queue->lock);
+        queue->tasks.push_back(tasks[i]);
+
+        this->nextQueue++;
+        if (this->nextQueue == this->numThreads) {
+            this->nextQueue = 0;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(this->stateLock);
+        this->generation++;
+    }
+    this->workAvailable.notify_all();
+}
+
+void ThreadPool::wait()
+{
+    this->runTasks(0);
+
+    // other threads may still be running stolen tasks
+    std::unique_lock<std::mutex> guard(this->stateLock);
+    this->workDone.wait(guard, [this] { return this->pending.load() == 0; });
+}
+
+void ThreadPool::workerLoop(int index)
+{
+    unsigned long seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(this->stateLock);
+            this->workAvailable.wait(guard,
+                [this, seen] { return this->stopping || this->generation != seen; });
+            if (this->stopping) {
+                return;
+            }
+            seen = this->generation;
+        }
+
+        this->runTasks(index);
+    }
+}
+
+void ThreadPool::runTasks(int index)
+{
+    Task task;
+    while (this->popTask(index, task) || this->stealTask(index, task)) {
+        task.function(task.arg);
+
+        // the last task to finish releases wait()
+        if (this->pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> guard(this->stateLock);
+            this->workDone.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::popTask(int index, Task& task)
+{
+    Queue*                      queue = this->queues[index];
+    std::lock_guard<std::mutex> guard(queue->lock);
+
+    if (queue->tasks.size() == queue->head) {
+        return false;
+    }
+
+    // newest first
+    task = queue->tasks.back();
+    queue->tasks.pop_back();
+
+    // keep the storage for the next batch once the queue drains
+    if (queue->tasks.size() == queue->head) {
+        queue->tasks.clear();
+        queue->head = 0;
+    }
+    return true;
+}
+
+bool ThreadPool::stealTask(int index, Task& task)
+{
+    for (int i = 1; i < this->numThreads; i++) {
+        Queue*                      queue = this->queues[(index + i) % this->numThreads];
+        std::lock_guard<std::mutex> guard(queue->lock);
+
+        if (queue->tasks.size() == queue->head) {
+            continue;
+        }
+
+        // oldest first, from the other end of the owner's queue
+        task = queue->tasks[queue->head];
+        queue->head++;
+
+        if (queue->tasks.size() == queue->head) {
+            queue->tasks.clear();
+            queue->head = 0;
+        }
+        return true;
+    }
+    return false;
+}
+
+#endif // ARDUINO
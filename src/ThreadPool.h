@@ -0,0 +1,106 @@
+/*
+ * @file
+ * Contains the ThreadPool class definition.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// threads are only available on hosts, Arduino targets run analysis serially
+#ifndef ARDUINO
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A work-stealing pool of threads that runs batches of independent tasks.
+ *
+ * Each thread, including the one calling wait(), owns a queue of tasks.
+ * Submitted tasks are spread over the queues round robin. A thread runs the
+ * tasks of its own queue newest first, and once it is empty, steals the
+ * oldest tasks from the other queues, so uneven tasks (e.g. Formants next to
+ * TotalAmplitude) still keep every thread busy.
+ *
+ * wait() is a barrier: it returns once every submitted task has finished.
+ * Tasks must not submit tasks themselves.
+ */
+class ThreadPool {
+public:
+    typedef void (*TaskFunction)(void* arg);
+
+    struct Task {
+        TaskFunction function;
+        void*        arg;
+    };
+
+    /**
+     * Creates a pool and starts its threads.
+     *
+     * @param numThreads The number of threads running tasks, including the
+     * thread calling wait(). 0 uses one per hardware thread.
+     */
+    ThreadPool(int numThreads = 0);
+
+    /**
+     * Stops and joins all threads. Pending tasks are not run.
+     */
+    ~ThreadPool();
+
+    int getNumThreads() const { return this->numThreads; };
+
+    /**
+     * Queues tasks to run on the pool.
+     *
+     * Does not allocate once the queues have grown to the largest batch.
+     *
+     * @param tasks The tasks to run, copied into the queues.
+     * @param numTasks The number of tasks.
+     */
+    void submit(const Task* tasks, int numTasks);
+
+    /**
+     * Runs queued tasks on the calling thread until all submitted tasks
+     * have finished.
+     */
+    void wait();
+
+private:
+    struct Queue {
+        std::mutex        lock;
+        std::vector<Task> tasks;
+        size_t            head; // index of the oldest task not yet taken
+    };
+
+    int numThreads;
+    int nextQueue; // queue receiving the next submitted task
+
+    // one queue per thread, queue 0 belongs to the thread calling wait()
+    std::vector<Queue*>      queues;
+    std::vector<std::thread> workers;
+
+    // tasks submitted but not finished
+    std::atomic<int> pending;
+
+    // wakes idle workers when tasks are submitted, and wait() when the
+    // last task finishes
+    std::mutex              stateLock;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+    unsigned long           generation;
+    bool                    stopping;
+
+    void workerLoop(int index);
+
+    // runs tasks until no queue has any left
+    void runTasks(int index);
+
+    bool popTask(int index, Task& task);
+    bool stealTask(int index, Task& task);
+};
+
+#endif // ARDUINO
+
+#endif // THREAD_POOL_H
@@ -36,7 +36,7 @@ void BreadSlicer::setBands(int* frequencyBands, int numBands)
         free(output); // free output
 
     // allocate memory for new bandIndexes and outpt pointers
-    this->bandIndexes = (int*)malloc(sizeof(int) * numBands + 1);
+    this->bandIndexes = (int*)malloc(sizeof(int) * (numBands + 1));
     this->output      = (float*)malloc(sizeof(float) * numBands);
     this->numBands    = numBands; // set new number of bands
 
@@ -54,22 +54,23 @@ void BreadSlicer::doAnalysis()
     if (this->bandIndexes == NULL)
         return; // do not run analysis if bands are not set
 
-    float* windowData = spectrogram->getCurrentWindow();
+    // with a prefix-sum index, each band sum is two lookups
+    if (spectrogram->hasPrefixSums()) {
+        const float* prefix = spectrogram->getPrefixSums();
+        for (int b = 0; b < this->numBands; b++) {
+            this->output[b] = prefix[this->bandIndexes[b + 1]] - prefix[this->bandIndexes[b]];
+        }
+    } else {
+        float* windowData = spectrogram->getCurrentWindow();
 
-    int   _bandIndex = 1;
-    float _bandSum   = 0;
-    // finds the total amplitude of each band by summing the bins within each band
-    // then stores that value in output
-    for (int i = this->bandIndexes[0]; i <= this->bandIndexes[this->numBands]; i++) {
-        // if still within the band, add amp to _bandSum
-        if (i < this->bandIndexes[_bandIndex]) {
-            _bandSum += windowData[i];
-        } else {
-            // if not within band, store sum of amplitudes for the band in output array
-            this->output[_bandIndex - 1] = _bandSum;
-            _bandIndex += 1;
-            _bandSum = 0;
-            i -= 1; // Decrease i to stay within the band range during the next loop iteration
+        // finds the total amplitude of each band by summing the bins within each band
+        // then stores that value in output
+        for (int b = 0; b < this->numBands; b++) {
+            float _bandSum = 0;
+            for (int i = this->bandIndexes[b]; i < this->bandIndexes[b + 1]; i++) {
+                _bandSum += windowData[i];
+            }
+            this->output[b] = _bandSum;
         }
     }
 
@@ -84,6 +85,14 @@ void BreadSlicer::doAnalysis()
     }
 }
 
+void BreadSlicer::storeFeatures(float* features, int stride)
+{
+    float* bandSums = getOutput();
+    for (int i = 0; i < numBands; i++) {
+        features[i * stride] = bandSums[i];
+    }
+}
+
 void BreadSlicer::printOutput()
 {
     Serial.printf("BreadSlicer sums: \n");
@@ -10,6 +10,7 @@
 #ifndef Bread_Slicer_h
 #define Bread_Slicer_h
 
+#include "../AnalysisContext.h"
 #include "../AnalysisModule.h"
 #include <cmath>
 
@@ -37,9 +38,115 @@ public:
     // Sums the amplitudes in each frequency band and stores the results in output.
     void doAnalysis();
 
+    // each band sum is one feature in a feature matrix
+    int  getNumFeatures() { return numBands; };
+    void storeFeatures(float* features, int stride);
+
     // Prints the sums (output) from the breadSlicer to the serial console
     // Can be called manually but will be included automatically when debug mode is enabled
     void printOutput();
 };
 
+// FixedBreadSlicer is a BreadSlicer whose audio context and number of bands
+// are fixed at compile time, see AnalysisContext.h
+// the band sums are stored in the module itself, so setting bands never allocates
+// Ex. FixedBreadSlicer<FixedContext<>, 4> slicer;
+//     int bands[] = { 0, 200, 500, 2000, 4000 };
+//     slicer.setBands(bands);
+template <class Context, int NumBands>
+class FixedBreadSlicer : public FixedModuleInterface<float*, Context> {
+    static_assert(NumBands > 0, "BreadSlicer needs at least one band.");
+
+private:
+    int   bandIndexes[NumBands + 1];
+    float sums[NumBands];
+    bool  bandsSet;
+
+public:
+    FixedBreadSlicer()
+    {
+        for (int i = 0; i < NumBands; i++) {
+            this->sums[i] = 0.0;
+        }
+        this->bandsSet = false;
+        this->output   = this->sums;
+    }
+
+    // sets the bands ('slices') of this module from NumBands + 1 frequencies
+    // in ascending order, the same rules as BreadSlicer::setBands() apply
+    void setBands(const int* frequencyBands)
+    {
+        const int _nyquist = Context::sampleRate >> 1;
+
+        // validate band boundaries are increasing and within valid range
+        for (int i = 0; i < NumBands; i++) {
+            if (!(frequencyBands[i] >= 0 && frequencyBands[i] < frequencyBands[i + 1] && frequencyBands[i + 1] <= _nyquist)) {
+                Serial.println("BreadSlicer setBands() fail! Invalid bands!");
+                return;
+            }
+        }
+
+        // find the FFT bin index of each freq and store it in bandIndexes
+        for (int i = 0; i < NumBands + 1; i++) {
+            this->bandIndexes[i] = round(frequencyBands[i] * Context::freqWidth);
+        }
+        this->bandsSet = true;
+    }
+
+    void doAnalysis()
+    {
+        if (!this->bandsSet)
+            return; // do not run analysis if bands are not set
+
+        // with a prefix-sum index, each band sum is two lookups
+        if (this->spectrogram->hasPrefixSums()) {
+            const float* prefix = this->spectrogram->getPrefixSums();
+            for (int b = 0; b < NumBands; b++) {
+                this->sums[b] = prefix[this->bandIndexes[b + 1]] - prefix[this->bandIndexes[b]];
+            }
+        } else {
+            float* windowData = this->spectrogram->getCurrentWindow();
+
+            // the band count is constant, so the band loop unrolls and each band
+            // is a branch-free sum over its own bins
+            for (int b = 0; b < NumBands; b++) {
+                float _bandSum = 0;
+                for (int i = this->bandIndexes[b]; i < this->bandIndexes[b + 1]; i++) {
+                    _bandSum += windowData[i];
+                }
+                this->sums[b] = _bandSum;
+            }
+        }
+
+        // if debug is enabled, print the output to the serial console
+        if (this->debugMode & DEBUG_ENABLE) {
+            Serial.printf("===BREADSLICER===\n");
+            if (this->debugMode & DEBUG_VERBOSE) {
+                this->printModuleInfo();
+            }
+            printOutput();
+            Serial.printf("=================\n");
+        }
+    }
+
+    // each band sum is one feature in a feature matrix
+    int getNumFeatures() { return NumBands; }
+
+    void storeFeatures(float* features, int stride)
+    {
+        float* bandSums = this->getOutput();
+        for (int b = 0; b < NumBands; b++) {
+            features[b * stride] = bandSums[b];
+        }
+    }
+
+    void printOutput()
+    {
+        Serial.printf("BreadSlicer sums: \n");
+        for (int i = 0; i < NumBands; i++) {
+            Serial.printf("[%d]: %f\n", i, this->sums[i]);
+        }
+    }
+};
+
 #endif
@@ -2,19 +2,18 @@
 
 void Centroid::doAnalysis()
 {
-    float* windowData = spectrogram->getCurrentWindow();
-    // get the sum of amplitudes and sum of frequencies*amplitudes
-    float ampSum     = 0; // total amp across bins
-    float freqAmpSum = 0;
-    int   amp, freq;
-    // calculate center frequency of the bin
-    // i * freqRes gives lower edge, adding freqResBy2 gives center
-    for (int i = lowerBinBound; i < upperBinBound; i++) {
-        amp  = windowData[i];
-        freq = (i * freqRes + freqResBy2); // use the center frequency of a bin
-        ampSum += amp;                     // get total amp
-        freqAmpSum += freq * amp;          // get total freq * amp (weighted sum)
-    }
+    // get the sum of bin index*amplitude and the sum of amplitudes, both are
+    // computed in a single pass and shared through the spectrogram's feature
+    // cache. The weighted sum is requested first: the sum alone is computed
+    // by a pass of its own.
+    FeatureCache* features    = spectrogram->getFeatures();
+    float         weightedSum = features->getWeightedSum(lowerBinBound, upperBinBound);
+    float         ampSum      = features->getSum(lowerBinBound, upperBinBound);
+
+    // get the sum of frequencies*amplitudes
+    // the center frequency of bin i is i * freqRes (lower edge) + freqResBy2, so
+    // sum(freq * amp) = freqRes * sum(i * amp) + freqResBy2 * sum(amp)
+    float freqAmpSum = freqRes * weightedSum + freqResBy2 * ampSum;
     // if ampSum 0, set centroid to 0 -- this means no signal
     // otherwise divide weighted frequency sum by total amplitude -- "center of mass"
     // lower centroid tends to be darker bassier sounds, higher centroids tend to be brighter sounds
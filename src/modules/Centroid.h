@@ -14,16 +14,55 @@
 #ifndef Centroid_h
 #define Centroid_h
 
+#include "../AnalysisContext.h"
 #include "../AnalysisModule.h"
+#include "../SpectralTools.h"
 #include <cmath>
 
 // Centroid inherits from the ModuleInterface with an int output type
-class Centroid : public ModuleInterface<float> {
+class Centroid final : public ModuleInterface<float> {
 public:
     float centroid;
     int   freqResBy2 = freqRes / 2; // divide freqRes by 2 to get the center value
 
     void doAnalysis();
+
+    // equivalent Centroid modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<Centroid>(); };
+};
+
+// FixedCentroid is a Centroid whose audio context and frequency range are
+// fixed at compile time, see AnalysisContext.h
+template <class Context = FixedContext<>>
+class FixedCentroid : public FixedModuleInterface<float, Context> {
+public:
+    float centroid = 0;
+
+    void doAnalysis()
+    {
+        float* windowData  = this->spectrogram->getCurrentWindow();
+        float  ampSum      = AudioPrism::fixed_sum<Context::numBins>(windowData + Context::lowerBin);
+        float  weightedSum = AudioPrism::fixed_weighted_sum<Context::lowerBin, Context::numBins>(windowData);
+
+        // same bin center frequencies as Centroid, sum(freq * amp) =
+        // freqRes * sum(i * amp) + freqResBy2 * sum(amp)
+        const int freqResBy2 = int(Context::freqRes / 2);
+        float     freqAmpSum = Context::freqRes * weightedSum + freqResBy2 * ampSum;
+        centroid             = (ampSum == 0) ? 0 : (freqAmpSum / ampSum);
+        this->output         = centroid;
+
+        // if debug is enabled, print the output to the serial console
+        if (this->debugMode & DEBUG_ENABLE) {
+            Serial.printf("===CENTROID===\n");
+            if (this->debugMode & DEBUG_VERBOSE) {
+                this->printModuleInfo();
+            }
+            Serial.printf("Amplitude Sum: %f\n", ampSum);
+            Serial.printf("Freq. Weighted Amp. Sum: %f\n", freqAmpSum);
+            Serial.printf("Centroid: %f\n", centroid);
+            Serial.printf("==============\n");
+        }
+    }
 };
 
 #endif
@@ -13,7 +13,8 @@ DeltaAmplitudes::~DeltaAmplitudes()
 void DeltaAmplitudes::doAnalysis()
 {
     float* currWindowData = spectrogram->getCurrentWindow();
-    float* prevWindowData = spectrogram->getPreviousWindow();
+    // with overlapping windows, the change is taken over a full window length
+    float* prevWindowData = spectrogram->getNonOverlappingWindow();
 
     // iterate through FFT data and store the change in amplitudes between current and previous window
     for (int i = lowerBinBound; i < upperBinBound; i++) {
@@ -33,6 +34,14 @@ void DeltaAmplitudes::doAnalysis()
     }
 }
 
+void DeltaAmplitudes::storeFeatures(float* features, int stride)
+{
+    float* deltas = getOutput();
+    for (int i = lowerBinBound; i < upperBinBound; i++) {
+        features[(i - lowerBinBound) * stride] = deltas[i];
+    }
+}
+
 void DeltaAmplitudes::printOutput()
 {
     Serial.printf("Delta Amplitudes: ");
@@ -4,7 +4,9 @@
 // Name        : DeltaAmplitudes
 // Return Type : float* (list of ampltidue deltas, indexed by frequency bin)
 // Description : Used to find the change in amplitudes between the current and
-//               previous FFT window for each bin.
+//               previous FFT window for each bin. With overlapping windows,
+//               the previous window is the last one that does not overlap
+//               the current window (see Spectrogram::setHopSize()).
 //============================================================================
 
 #ifndef Delta_Amplitudes_h
@@ -14,7 +16,7 @@
 #include <cmath>
 
 // DeltaAmplitudes inherits from the ModuleInterface with a float* output type
-class DeltaAmplitudes : public ModuleInterface<float*> {
+class DeltaAmplitudes final : public ModuleInterface<float*> {
 public:
     float* deltaAmplitudes;
 
@@ -24,6 +26,13 @@ public:
 
     void doAnalysis();
 
+    // equivalent DeltaAmplitudes modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<DeltaAmplitudes>(); };
+
+    // the delta of each bin in the analysis range is one feature in a feature matrix
+    int  getNumFeatures() { return upperBinBound - lowerBinBound; };
+    void storeFeatures(float* features, int stride);
+
     void printOutput();
 };
 
@@ -0,0 +1,205 @@
+#include "Filterbank.h"
+
+// conversions between Hz and each frequency scale
+static float hz_to_scale(FilterbankScale scale, float freq)
+{
+    switch (scale) {
+    case SCALE_BARK:
+        return 26.81f * freq / (1960.0f + freq) - 0.53f;
+    case SCALE_ERB:
+        return 21.4f * log10f(1.0f + 0.00437f * freq);
+    default:
+        return 2595.0f * log10f(1.0f + freq / 700.0f);
+    }
+}
+
+static float scale_to_hz(FilterbankScale scale, float value)
+{
+    switch (scale) {
+    case SCALE_BARK:
+        return 1960.0f * (value + 0.53f) / (26.28f - value);
+    case SCALE_ERB:
+        return (powf(10.0f, value / 21.4f) - 1.0f) / 0.00437f;
+    default:
+        return 700.0f * (powf(10.0f, value / 2595.0f) - 1.0f);
+    }
+}
+
+Filterbank::Filterbank()
+{
+    this->numBands = 0; // initialize number of bands to 0
+    this->power    = false;
+
+    this->bandStarts  = NULL;
+    this->bandOffsets = NULL;
+    this->weights     = NULL;
+    this->output      = NULL; // initialize output pointer to null
+}
+
+Filterbank::~Filterbank()
+{
+    freeBands();
+}
+
+void Filterbank::freeBands()
+{
+    delete[] this->bandStarts;
+    delete[] this->bandOffsets;
+    delete[] this->weights;
+    delete[] this->output;
+
+    this->bandStarts  = NULL;
+    this->bandOffsets = NULL;
+    this->weights     = NULL;
+    this->output      = NULL;
+    this->numBands    = 0;
+}
+
+void Filterbank::setBands(FilterbankScale scale, int numBands, int lowerFreq, int upperFreq)
+{
+    int _nyquist = sampleRate >> 1; // nyquist frequency is 1/2 the sampleRate
+
+    if (numBands <= 0 || lowerFreq < 0 || lowerFreq >= upperFreq || upperFreq > _nyquist) {
+        Serial.println("Filterbank setBands() fail! Invalid bands!");
+        return;
+    }
+
+    // numBands + 2 edges evenly spaced on the scale, converted back to Hz
+    float* edges      = new float[numBands + 2];
+    float  lowerValue = hz_to_scale(scale, lowerFreq);
+    float  upperValue = hz_to_scale(scale, upperFreq);
+    for (int i = 0; i < numBands + 2; i++) {
+        float value = lowerValue + (upperValue - lowerValue) * i / (numBands + 1);
+        edges[i]    = scale_to_hz(scale, value);
+    }
+    // the ends are exact, not round trips through the scale
+    edges[0]            = lowerFreq;
+    edges[numBands + 1] = upperFreq;
+
+    setTriangles(edges, numBands);
+    delete[] edges;
+}
+
+void Filterbank::setBands(const int* edgeFrequencies, int numBands)
+{
+    int _nyquist = sampleRate >> 1; // nyquist frequency is 1/2 the sampleRate
+
+    // validate edges are increasing and within valid range
+    bool valid = numBands > 0 && edgeFrequencies[0] >= 0;
+    for (int i = 0; valid && i < numBands + 1; i++) {
+        valid = edgeFrequencies[i] < edgeFrequencies[i + 1] && edgeFrequencies[i + 1] <= _nyquist;
+    }
+    if (!valid) {
+        Serial.println("Filterbank setBands() fail! Invalid bands!");
+        return;
+    }
+
+    float* edges = new float[numBands + 2];
+    for (int i = 0; i < numBands + 2; i++) {
+        edges[i] = edgeFrequencies[i];
+    }
+    setTriangles(edges, numBands);
+    delete[] edges;
+}
+
+void Filterbank::setTriangles(const float* edges, int numBands)
+{
+    freeBands();
+
+    this->numBands    = numBands;
+    this->bandStarts  = new int[numBands];
+    this->bandOffsets = new int[numBands + 1];
+    this->output      = new float[numBands];
+
+    // the bins strictly inside each triangle, the edges have a weight of 0
+    int numWeights = 0;
+    for (int b = 0; b < numBands; b++) {
+        int firstBin = floor(edges[b] * freqWidth) + 1;
+        int lastBin  = ceil(edges[b + 2] * freqWidth) - 1;
+        if (lastBin > windowSizeBy2 - 1) {
+            lastBin = windowSizeBy2 - 1;
+        }
+        // a triangle narrower than a bin gets the bin nearest its center
+        if (lastBin < firstBin) {
+            firstBin = lastBin = round(edges[b + 1] * freqWidth);
+            if (firstBin > windowSizeBy2 - 1) {
+                firstBin = lastBin = windowSizeBy2 - 1;
+            }
+        }
+        this->bandStarts[b]  = firstBin;
+        this->bandOffsets[b] = numWeights;
+        numWeights += lastBin - firstBin + 1;
+    }
+    this->bandOffsets[numBands] = numWeights;
+
+    this->weights = new float[numWeights];
+    for (int b = 0; b < numBands; b++) {
+        float lower  = edges[b];
+        float center = edges[b + 1];
+        float upper  = edges[b + 2];
+        int   count  = this->bandOffsets[b + 1] - this->bandOffsets[b];
+        for (int i = 0; i < count; i++) {
+            float freq   = (this->bandStarts[b] + i) * freqRes;
+            float weight = freq <= center ? (freq - lower) / (center - lower)
+                                          : (upper - freq) / (upper - center);
+            if (count == 1 || weight > 1.0f) {
+                weight = 1.0f;
+            }
+            this->weights[this->bandOffsets[b] + i] = weight;
+        }
+        this->output[b] = 0.0; // initialize the band to 0
+    }
+}
+
+void Filterbank::doAnalysis()
+{
+    if (this->weights == NULL)
+        return; // do not run analysis if bands are not set
+
+    float* windowData = spectrogram->getCurrentWindow();
+
+    // a sparse matrix-vector product: each band is a dot product of its
+    // weights with the bins under it
+    for (int b = 0; b < this->numBands; b++) {
+        const float* bins     = windowData + this->bandStarts[b];
+        const float* bandW    = this->weights + this->bandOffsets[b];
+        int          count    = this->bandOffsets[b + 1] - this->bandOffsets[b];
+        float        _bandSum = 0;
+        if (this->power) {
+            for (int i = 0; i < count; i++) {
+                _bandSum += bandW[i] * bins[i] * bins[i];
+            }
+        } else {
+            for (int i = 0; i < count; i++) {
+                _bandSum += bandW[i] * bins[i];
+            }
+        }
+        this->output[b] = _bandSum;
+    }
+
+    // if debug is enabled, print the output to the serial console
+    if (debugMode & DEBUG_ENABLE) {
+        Serial.printf("===FILTERBANK===\n");
+        if (debugMode & DEBUG_VERBOSE) {
+            printModuleInfo();
+        }
+        printOutput();
+        Serial.printf("================\n");
+    }
+}
+
+void Filterbank::storeFeatures(float* features, int stride)
+{
+    float* bandSums = getOutput();
+    for (int i = 0; i < numBands; i++) {
+        features[i * stride] = bandSums[i];
+    }
+}
+
+void Filterbank::printOutput()
+{
+    Serial.printf("Filterbank sums: \n");
+    for (int i = 0; i < numBands; i++) {
+        Serial.printf("[%d]: %f\n", i, output[i]);
+    }
+}
@@ -0,0 +1,91 @@
+//============================================================================
+// MODULE INFORMATION
+//============================================================================
+// Name        : Filterbank
+// Return Type : float*
+// Description : Analysis method that weights the frequency spectrum with a
+//               bank of overlapping triangular filters spaced on a perceptual
+//               (mel, bark or ERB) or custom frequency scale, and outputs the
+//               weighted sum of each filter, ordered from lowest to highest.
+//               The weights are computed once when the bands are set, and
+//               stored sparsely, so each frame only visits the bins under
+//               each filter.
+//============================================================================
+#ifndef Filterbank_h
+#define Filterbank_h
+
+#include "../AnalysisModule.h"
+#include <cmath>
+
+// frequency scales the filters can be evenly spaced on
+enum FilterbankScale {
+    SCALE_MEL,  // 2595 * log10(1 + f / 700)
+    SCALE_BARK, // Traunmueller: 26.81 * f / (1960 + f) - 0.53
+    SCALE_ERB   // ERB-rate: 21.4 * log10(1 + 0.00437 * f)
+};
+
+// Filterbank inherits from the ModuleInterface with a float* output type
+class Filterbank : public ModuleInterface<float*> {
+private:
+    int numBands;
+
+    // the weights of band b apply to bins bandStarts[b] onwards, and are
+    // weights[bandOffsets[b]] up to (excluding) weights[bandOffsets[b + 1]]
+    int*   bandStarts;
+    int*   bandOffsets;
+    float* weights;
+
+    // weight squared amplitudes (band energies) instead of amplitudes
+    bool power;
+
+    // frees the weights and output, if allocated
+    void freeBands();
+
+    // computes the sparse weights of numBands triangles, band b rising from
+    // edges[b] to edges[b + 1] and falling to edges[b + 2], in Hz
+    void setTriangles(const float* edges, int numBands);
+
+public:
+    // default constructor, initializes private members.
+    // setBands() must be used to setup this module
+    Filterbank();
+
+    // deconstructor, frees member pointers if memory was allocated
+    ~Filterbank();
+
+    /* sets numBands triangular filters evenly spaced on a frequency scale
+      between lowerFreq and upperFreq (Hz), each rising from the center of the
+      previous filter to a weight of 1 at its center, then falling to the
+      center of the next one
+      Ex. setBands(SCALE_MEL, 40, 0, 4000);
+      Uses the module's sample rate and window size, so set those first
+    */
+    void setBands(FilterbankScale scale, int numBands, int lowerFreq, int upperFreq);
+
+    /* sets numBands custom triangular filters from numBands + 2 edge
+      frequencies in ascending order: band b rises from edgeFrequencies[b] to
+      edgeFrequencies[b + 1] and falls to edgeFrequencies[b + 2]
+      Ex. int edges[] = {0, 200, 500, 1000, 2000, 4000};
+          setBands(edges, 4);
+    */
+    void setBands(const int* edgeFrequencies, int numBands);
+
+    // weight the squared amplitudes (band energies, e.g. for MFCC) instead of
+    // the amplitudes, disabled by default
+    void setPowerSpectrum(bool power) { this->power = power; };
+
+    int getNumBands() const { return numBands; };
+
+    // Applies the filters to the current window and stores the results in output.
+    void doAnalysis();
+
+    // each band is one feature in a feature matrix
+    int  getNumFeatures() { return numBands; };
+    void storeFeatures(float* features, int stride);
+
+    // Prints the band sums (output) to the serial console
+    // Can be called manually but will be included automatically when debug mode is enabled
+    void printOutput();
+};
+
+#endif
@@ -1,68 +1,96 @@
 #include "Formants.h"
 
-Formants::Formants()
+//============================================================================
+// FORMANT DATA TABLE
+//============================================================================
+
+// Data from the Department of Computer Science at the University of Chicago
+// https://www.classes.cs.uchicago.edu/archive/1999/spring/CS295/Computing_Resources/Csound/CsManual3.48b1.HTML/Appendices/table3.html
+
+// fpeak frequencies of each vowel, in each vocal register
+static const float formant_data[5][5][MAX_FPEAKS] = {
+    // bass
+    { { 600, 1040, 2250, 2450, 2750 }, { 400, 1620, 2400, 2800, 3100 }, { 250, 1750, 2600, 3050, 3340 }, { 400, 750, 2400, 2600, 2900 }, { 350, 600, 2400, 2675, 2900 } },
+    // tenor
+    { { 650, 1080, 2650, 2900, 3250 }, { 400, 1700, 2600, 3200, 3580 }, { 290, 1870, 2800, 3250, 3540 }, { 400, 800, 2600, 2800, 3000 }, { 350, 600, 2700, 2900, 3300 } },
+    // countertenor
+    { { 660, 1120, 2750, 3000, 3350 }, { 440, 1800, 2700, 3000, 3350 }, { 270, 1850, 2900, 3350, 3590 }, { 430, 820, 2700, 3000, 3300 }, { 370, 630, 2750, 3000, 3400 } },
+    // alto
+    { { 800, 1150, 2800, 3500, 4950 }, { 400, 1600, 2700, 3300, 4950 }, { 350, 1700, 2700, 3700, 4950 }, { 450, 800, 2830, 3500, 4950 }, { 325, 700, 2530, 3500, 4950 } },
+    // soprano
+    { { 800, 1150, 2900, 3900, 4950 }, { 350, 200, 2800, 3600, 4950 }, { 270, 2140, 2950, 3900, 4950 }, { 450, 800, 2830, 3800, 4950 }, { 325, 700, 2700, 3800, 4950 } }
+};
+
+static const char vowel_labels[5] = { 'a', 'e', 'i', 'o', 'u' };
+
+//============================================================================
+// FORMANT TABLE
+//============================================================================
+
+FormantTable::FormantTable(int capacity)
 {
-    this->addSubmodule(&peak_finder);
-    for (int i = 0; i < 5; i++) {
-        formant_table[i][0].set_profile(bass[i]);
-        formant_table[i][1].set_profile(tenor[i]);
-        formant_table[i][2].set_profile(ctenor[i]);
-        formant_table[i][3].set_profile(alto[i]);
-        formant_table[i][4].set_profile(soprano[i]);
+    if (capacity < 0) {
+        capacity = 0;
+    }
+    this->capacity    = capacity;
+    this->numProfiles = 0;
+    this->labels      = new char[capacity];
+    this->frequencies = new float[MAX_FPEAKS * capacity];
+
+    // the squared difference of fpeak i is penalized by FPEAK_PENALTY^i
+    // if frequency normalization is enabled, differences are scaled up by
+    // 1000 to prevent underflows
+    float weight = FREQUENCY_NORMALIZATION ? 1000.0 * 1000.0 : 1.0;
+    for (int fpeak = 0; fpeak < MAX_FPEAKS; fpeak++) {
+        this->weights[fpeak] = weight;
+        weight *= (float)FPEAK_PENALTY;
     }
 }
 
-char Formants::vowel_to_character(int vowel, float distance)
+FormantTable::~FormantTable()
 {
-    if (distance > 100)
-        return '-';
-    switch (vowel) {
-    case 0:
-        return 'a';
-    case 1:
-        return 'e';
-    case 2:
-        return 'i';
-    case 3:
-        return 'o';
-    case 4:
-        return 'u';
-    default:
-        return '-';
-    }
+    delete[] labels;
+    delete[] frequencies;
 }
 
-float Formants::calculate_distance(FormantProfile* profile, float* found_peaks)
+bool FormantTable::addProfile(char label, const float* frequencies)
 {
-    // initialize distance to 0
-    // a partial sum is added to distance each iteration of the for loop
-    float distance = 0;
-
-    // calculate partial sum for 5 peaks
-    for (int fpeak = 0; fpeak < num_fpeaks; fpeak++) {
-        // calculate distance between measured peak and profile peak
-        // 1. take the absolute difference in frequency between peaks
-
-        float d = abs(profile->frequency[fpeak] - found_peaks[fpeak]);
-        // 2. if difference is within bandwidth, set distance to 0
-        // d = std::max((float) 0.0, (float) d - profile->bandwidth[fpeak]);
-        // 3. square the distance
-        // if frequency normalization is enabled, increase d to prevent underflows
-        if (FREQUENCY_NORMALIZATION) {
-            d *= 1000;
-        }
-        d *= d;
+    if (numProfiles == capacity) {
+        Serial.printf("Error: FormantTable is full.\n");
+        return false;
+    }
 
-        for (int i = 0; i < fpeak; i++) {
-            d *= (float)FPEAK_PENALTY;
+    // with frequency normalization, profiles are relative to their highest fpeak
+    float divisor = 1.0;
+    if (FREQUENCY_NORMALIZATION) {
+        for (int fpeak = 0; fpeak < MAX_FPEAKS; fpeak++) {
+            divisor = fmax(divisor, frequencies[fpeak]);
         }
+    }
 
-        // add partial sum to total distance
-        distance += d;
+    labels[numProfiles] = label;
+    for (int fpeak = 0; fpeak < MAX_FPEAKS; fpeak++) {
+        this->frequencies[fpeak * capacity + numProfiles] = frequencies[fpeak] / divisor;
     }
+    numProfiles++;
+    return true;
+}
 
-    // take square root of the complete sum
-    return (float)pow(distance, 0.5);
+//============================================================================
+// FORMANTS
+//============================================================================
+
+Formants::Formants()
+{
+    this->addSubmodule(&peak_finder);
+
+    // profiles are ordered by register, then vowel
+    for (int reg = BASS; reg < SOPRANO + 1; reg++) {
+        for (int vow = VOWEL_A; vow < VOWEL_U + 1; vow++) {
+            default_table.addProfile(vowel_labels[vow], formant_data[reg][vow]);
+        }
+    }
+    this->table = &default_table;
 }
 
 int Formants::interpolateAroundPeak(const float* data, int indexOfPeak, int sampleRate, int windowSize)
@@ -86,11 +114,16 @@ void Formants::setNumPeaks(int peaks)
         this->num_fpeaks = peaks;
 }
 
+void Formants::setTable(const FormantTable* table)
+{
+    this->table = table != NULL ? table : &default_table;
+}
+
 void Formants::doAnalysis()
 {
 
     // find the f peaks in the data
-    peak_finder.doAnalysis();
+    peak_finder.analyze();
     float** found_peaks = peak_finder.getOutput();
 
     if (found_peaks[0][1] == 0) {
@@ -98,49 +131,66 @@ void Formants::doAnalysis()
         return;
     }
 
+    // interpolate the frequency of each peak, the peaks may be shared with
+    // other modules so they are only read
+    float formants[MAX_FPEAKS] = { 0, 0, 0, 0, 0 };
+    for (int i = 0; i < MAX_FPEAKS; i++) {
+        formants[i] = interpolateAroundPeak(spectrogram->getCurrentWindow(),
+            round(int(found_peaks[0][i] * freqWidth)), sampleRate, windowSize);
+    }
+
     if (FREQUENCY_NORMALIZATION) {
         int n = 0;
         // find highest frequency
-        for (int i = 0; i < 5; i++) {
+        for (int i = 0; i < MAX_FPEAKS; i++) {
             if (found_peaks[0][i] != 0) {
                 n = i;
             } else {
                 break;
             }
         }
-        float divisor = found_peaks[0][n];
+        float divisor = formants[n];
         // divide entries by highest frequency
         for (int i = 0; i < n + 1; i++) {
-            found_peaks[0][i] /= divisor;
+            formants[i] /= divisor;
         }
     }
-    float formants[5] = { 0, 0, 0, 0, 0 };
-    for (int i = 0; i < 5; i++) {
-        formants[i] = interpolateAroundPeak(spectrogram->getCurrentWindow(),
-            round(int(found_peaks[0][i] * freqWidth)), sampleRate, windowSize);
-    }
 
     // initalize variables used to save the best match
+    // distances are compared squared, only the best is checked against the threshold
     float lowest_distance = FLT_MAX;
-    int   vocal_register  = -1;
-    int   formant_vowel   = -1;
-
-    // compare the f peaks against stored formant profiles
-    for (int reg = BASS; reg < SOPRANO + 1; reg++) {
-        for (int vow = VOWEL_A; vow < VOWEL_U + 1; vow++) {
-
-            // calculate distance
-            float distance = calculate_distance(&formant_table[reg][vow], formants);
+    int   best_profile    = -1;
+
+    // compare the f peaks against the profiles a block at a time, the
+    // distances of a block are accumulated fpeak by fpeak
+    int numProfiles = table->getNumProfiles();
+    for (int start = 0; start < numProfiles; start += FORMANT_BLOCK) {
+        int   count                     = min(FORMANT_BLOCK, numProfiles - start);
+        float distances[FORMANT_BLOCK] = { 0 };
+
+        for (int fpeak = 0; fpeak < num_fpeaks; fpeak++) {
+            const float* profiles = table->getFrequencies(fpeak) + start;
+            float        found    = formants[fpeak];
+            float        weight   = table->getWeight(fpeak);
+            for (int j = 0; j < count; j++) {
+                float d = profiles[j] - found;
+                distances[j] += weight * (d * d);
+            }
+        }
 
-            // if distance is lowest seen so far, update best match information
-            if (distance < lowest_distance) {
-                lowest_distance = distance;
-                vocal_register  = reg;
-                formant_vowel   = vow;
+        // if distance is lowest seen so far, update best match information
+        for (int j = 0; j < count; j++) {
+            if (distances[j] < lowest_distance) {
+                lowest_distance = distances[j];
+                best_profile    = start + j;
             }
         }
     }
 
-    // output the character of the best matched vowel
-    output = vowel_to_character(formant_vowel, lowest_distance);
+    // output the label of the best matched profile
+    if (best_profile < 0 || lowest_distance > FORMANT_MAX_DISTANCE * FORMANT_MAX_DISTANCE) {
+        output = '-';
+    } else {
+        output = table->getLabel(best_profile);
+    }
 }
@@ -22,12 +22,22 @@
 
 #define FPEAK_PENALTY 0.9
 
+// Maximum number of fpeaks a profile holds
+#define MAX_FPEAKS 5
+
+// Distance above which no profile matches, and '-' is output
+#define FORMANT_MAX_DISTANCE 100
+
+// Number of profiles whose distances are accumulated together, in a block on
+// the stack that the compiler can vectorize
+#define FORMANT_BLOCK 16
+
 //============================================================================
 // HELPERS
 //============================================================================
 
 // These macros are used to make indexing the formant table more readable:
-// The formant table stores frequency, amplitude, and bandwidth data for each vowel in each vocal register
+// The formant table stores frequency data for each vowel in each vocal register
 
 // vocal register macros
 #define BASS    0
@@ -43,21 +53,45 @@
 #define VOWEL_O 3
 #define VOWEL_U 4
 
-class FormantProfile {
+// FormantTable is an inventory of formant profiles, each a label (e.g. the
+// vowel it stands for) and the frequencies of its MAX_FPEAKS fpeaks
+// the frequencies are stored as a structure of arrays, fpeak by fpeak, so the
+// distances of many profiles are computed together, and the penalty of each
+// fpeak (FPEAK_PENALTY per fpeak) is computed once, as a weight of its squared
+// difference
+// Ex. FormantTable table = FormantTable(10);
+//     float ah[MAX_FPEAKS] = { 700, 1220, 2600, 3200, 3600 };
+//     table.addProfile('a', ah);
+//     formants.setTable(&table);
+class FormantTable {
 public:
-    float* frequency;
-    // float *bandwidth;
+    // creates an empty table with room for capacity profiles
+    FormantTable(int capacity);
 
-    // copy references to stored data
-    void set_profile(float* freqs /*, float *bandwidth*/);
-};
+    ~FormantTable();
 
-//============================================================================
-// FORMANT DATA TABLE
-//============================================================================
+    // adds a profile from its MAX_FPEAKS fpeak frequencies in Hz, returns false
+    // if the table is full
+    bool addProfile(char label, const float* frequencies);
+
+    int getNumProfiles() const { return numProfiles; };
+
+    char getLabel(int profile) const { return labels[profile]; };
 
-// Data from the Department of Computer Science at the University of Chicago
-// https://www.classes.cs.uchicago.edu/archive/1999/spring/CS295/Computing_Resources/Csound/CsManual3.48b1.HTML/Appendices/table3.html
+    // the frequencies of one fpeak of all profiles, numProfiles values
+    const float* getFrequencies(int fpeak) const { return frequencies + fpeak * capacity; };
+
+    // the weight of the squared difference of an fpeak in the distance
+    float getWeight(int fpeak) const { return weights[fpeak]; };
+
+private:
+    int   capacity;
+    int   numProfiles;
+    float weights[MAX_FPEAKS];
+
+    char*  labels;
+    float* frequencies; // MAX_FPEAKS rows of capacity frequencies
+};
 
 //============================================================================
 // CLASS DEFINITION
@@ -65,29 +99,32 @@ public:
 class Formants : public ModuleInterface<char> {
 private:
     // The number of formant peaks to use in the analysis (between 2-5)
-    int num_fpeaks = 5;
+    int num_fpeaks = NUM_FPEAKS;
 
     MajorPeaks peak_finder = MajorPeaks(5);
 
-    float bass[5][5]    = { { 600.0, 1040.0, 2250.0, 2450.0, 2750.0 }, { 400, 1620, 2400, 2800, 3100 }, { 250, 1750, 2600, 3050, 3340 }, { 400, 750, 2400, 2600, 2900 }, { 350, 600, 2400, 2675, 2900 } };
-    float tenor[5][5]   = { { 650, 1080, 2650, 2900, 3250 }, { 400, 1700, 2600, 3200, 3580 }, { 290, 1870, 2800, 3250, 3540 }, { 400, 800, 2600, 2800, 3000 }, { 350, 600, 2700, 2900, 3300 } };
-    float ctenor[5][5]  = { { 660, 1120, 2750, 3000, 3350 }, { 440, 1800, 2700, 3000, 3350 }, { 270, 1850, 2900, 3350, 3590 }, { 430, 820, 2700, 3000, 3300 }, { 370, 630, 2750, 3000, 3400 } };
-    float alto[5][5]    = { { 800, 1150, 2800, 3500, 4950 }, { 400, 1600, 2700, 3300, 4950 }, { 350, 1700, 2700, 3700, 4950 }, { 450, 800, 2830, 3500, 4950 }, { 325, 700, 2530, 3500, 4950 } };
-    float soprano[5][5] = { { 800, 1150, 2900, 3900, 4950 }, { 350, 200, 2800, 3600, 4950 }, { 270, 2140, 2950, 3900, 4950 }, { 450, 800, 2830, 3800, 4950 }, { 325, 700, 2700, 3800, 4950 } };
+    // the five vowels of the five vocal registers of the data table above
+    FormantTable default_table = FormantTable(25);
 
-public:
-    FormantProfile formant_table[5][5];
+    // the profiles matched against, default_table unless set otherwise
+    const FormantTable* table;
 
+public:
     Formants();
 
-    char vowel_to_character(int vowel, float distance);
-
-    float calculate_distance(FormantProfile* profile, float* found_peaks);
-
     int interpolateAroundPeak(const float* data, int indexOfPeak, int sampleRate, int windowSize);
 
     void setNumPeaks(int peaks);
 
+    // match against the profiles of another table, which must outlive the
+    // module, e.g. a larger vowel inventory for other languages or speakers
+    // NULL restores the default table
+    void setTable(const FormantTable* table);
+
+    const FormantTable* getTable() const { return table; };
+
+    // outputs the label of the profile nearest to the formants of the current
+    // window, or '-' if no profile is within FORMANT_MAX_DISTANCE
     void doAnalysis();
 };
 
@@ -0,0 +1,126 @@
+#include "MFCC.h"
+
+// floor of the band energies, so silent bands have a finite log
+#define MFCC_ENERGY_FLOOR 1e-10f
+
+MFCC::MFCC()
+{
+    init(13, 40);
+}
+
+MFCC::MFCC(int numCoeffs, int numBands)
+{
+    init(numCoeffs, numBands);
+}
+
+MFCC::~MFCC()
+{
+    delete[] coefficients;
+    delete[] logEnergies;
+    delete[] dctTable;
+}
+
+void MFCC::init(int numCoeffs, int numBands)
+{
+    if (numBands < 1) {
+        numBands = 1;
+    }
+    if (numCoeffs < 1) {
+        numCoeffs = 1;
+    }
+    if (numCoeffs > numBands) {
+        numCoeffs = numBands;
+    }
+
+    this->numCoeffs = numCoeffs;
+    this->numBands  = numBands;
+    this->addSubmodule(&melBank);
+
+    coefficients = new float[numCoeffs];
+    logEnergies  = new float[numBands];
+    dctTable     = new float[numCoeffs * numBands];
+    for (int k = 0; k < numCoeffs; k++) {
+        coefficients[k] = 0.0;
+    }
+
+    // orthonormal DCT-II: c[k] = s(k) * sum(x[n] * cos(pi * k * (n + 0.5) / N))
+    // with s(0) = sqrt(1 / N), s(k) = sqrt(2 / N)
+    for (int k = 0; k < numCoeffs; k++) {
+        double scale = sqrt((k == 0 ? 1.0 : 2.0) / numBands);
+        for (int n = 0; n < numBands; n++) {
+            dctTable[k * numBands + n] = scale * cos(M_PI * k * (n + 0.5) / numBands);
+        }
+    }
+
+    melBank.setPowerSpectrum(true);
+    setFrequencyRange(0, sampleRate >> 1);
+
+    output = coefficients;
+}
+
+void MFCC::setFrequencyRange(int lowerFreq, int upperFreq)
+{
+    this->lowerFreq = lowerFreq;
+    this->upperFreq = upperFreq;
+    melBank.setBands(SCALE_MEL, numBands, lowerFreq, upperFreq);
+    parametersChanged();
+}
+
+bool MFCC::isEquivalent(const AnalysisModule* other) const
+{
+    if (!AnalysisModule::isEquivalent(other)) {
+        return false;
+    }
+
+    // the type check makes the cast safe
+    const MFCC* peer = (const MFCC*)other;
+    return peer->numCoeffs == this->numCoeffs && peer->numBands == this->numBands
+        && peer->lowerFreq == this->lowerFreq && peer->upperFreq == this->upperFreq;
+}
+
+void MFCC::doAnalysis()
+{
+    melBank.analyze();
+
+    // log compression of the band energies
+    float* energies = melBank.getOutput();
+    for (int n = 0; n < numBands; n++) {
+        logEnergies[n] = logf(energies[n] + MFCC_ENERGY_FLOOR);
+    }
+
+    // DCT-II of the log energies, one row of the table per coefficient
+    for (int k = 0; k < numCoeffs; k++) {
+        const float* basis = dctTable + k * numBands;
+        float        sum   = 0.0f;
+        for (int n = 0; n < numBands; n++) {
+            sum += basis[n] * logEnergies[n];
+        }
+        coefficients[k] = sum;
+    }
+
+    // if debug is enabled, print the output to the serial console
+    if (debugMode & DEBUG_ENABLE) {
+        Serial.printf("===MFCC===\n");
+        if (debugMode & DEBUG_VERBOSE) {
+            printModuleInfo();
+        }
+        printOutput();
+        Serial.printf("==========\n");
+    }
+}
+
+void MFCC::storeFeatures(float* features, int stride)
+{
+    float* coeffs = getOutput();
+    for (int k = 0; k < numCoeffs; k++) {
+        features[k * stride] = coeffs[k];
+    }
+}
+
+void MFCC::printOutput()
+{
+    Serial.printf("MFCC coefficients: \n");
+    for (int k = 0; k < numCoeffs; k++) {
+        Serial.printf("[%d]: %f\n", k, coefficients[k]);
+    }
+}
@@ -0,0 +1,75 @@
+//============================================================================
+// MODULE INFORMATION
+//============================================================================
+// Name        : MFCC
+// Return Type : float* (array of numCoeffs mel-frequency cepstral coefficients)
+// Description : Computes the mel-frequency cepstral coefficients of the
+//               current window: the energies of a mel Filterbank are log
+//               compressed and decorrelated by a DCT-II, whose cosines are
+//               tabulated when the module is created. Coefficient 0 tracks
+//               the overall log energy, the following ones the shape of the
+//               spectral envelope. A frame allocates nothing and computes no
+//               trigonometric functions.
+//============================================================================
+#ifndef MFCC_h
+#define MFCC_h
+
+#include "../AnalysisModule.h"
+#include "Filterbank.h"
+
+// MFCC inherits from the ModuleInterface with a float* output type
+// this module contains one submodule, a mel Filterbank
+class MFCC final : public ModuleInterface<float*> {
+private:
+    int numCoeffs;
+    int numBands;
+    int lowerFreq;
+    int upperFreq;
+
+    // output coefficients, and the log energy of each band
+    float* coefficients;
+    float* logEnergies;
+
+    // orthonormal DCT-II basis, row k holds the numBands weights of coefficient k
+    float* dctTable;
+
+    // the mel bands, weighting squared amplitudes
+    Filterbank melBank = Filterbank();
+
+    // allocates the arrays and fills the DCT table
+    void init(int numCoeffs, int numBands);
+
+public:
+    // default constructor, 13 coefficients from 40 mel bands over the full spectrum
+    MFCC();
+
+    // constructor with the number of coefficients, and of mel bands they are
+    // computed from, numCoeffs must not exceed numBands
+    MFCC(int numCoeffs, int numBands = 40);
+
+    // destructor, frees the coefficients and tables
+    ~MFCC();
+
+    // sets the frequency range (Hz) the mel bands span, the full spectrum by
+    // default. The bands use the module's sample rate and window size, so call
+    // this again after changing those
+    void setFrequencyRange(int lowerFreq, int upperFreq);
+
+    int getNumCoeffs() const { return numCoeffs; };
+
+    // computes the coefficients of the current window, stored in output
+    void doAnalysis();
+
+    // equivalent MFCC modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<MFCC>(); };
+    bool        isEquivalent(const AnalysisModule* other) const;
+
+    // each coefficient is one feature in a feature matrix
+    int  getNumFeatures() { return numCoeffs; };
+    void storeFeatures(float* features, int stride);
+
+    // Prints the coefficients (output) to the serial console
+    void printOutput();
+};
+
+#endif
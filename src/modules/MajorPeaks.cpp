@@ -1,25 +1,24 @@
 #include "MajorPeaks.h"
 
+#include <algorithm>
+#include <utility>
+
 MajorPeaks::MajorPeaks()
 {
     // restrict the number of peaks to find to 4
     maxNumPeaks = 4;
-
-    // allocate memory for output array
-    // output[MP_FREQ] is an array of frequencies, indexed by peak number
-    // output[MP_AMP] is an array of amplitudes, indexed by peak number
-    // peaks are always stored in order of increasing frequency
-    // if there are fewer than maxNumPeaks peaks, the remaining elements are padded with zeros
-    output          = new float*[2];
-    output[MP_FREQ] = new float[maxNumPeaks];
-    output[MP_AMP]  = new float[maxNumPeaks];
+    allocatePeaks();
 }
 
 MajorPeaks::MajorPeaks(int n)
 {
     // restrict the number of peaks to find to n
-    maxNumPeaks = n;
+    maxNumPeaks = n < 0 ? 0 : n;
+    allocatePeaks();
+}
 
+void MajorPeaks::allocatePeaks()
+{
     // allocate memory for output array
     // output[MP_FREQ] is an array of frequencies, indexed by peak number
     // output[MP_AMP] is an array of amplitudes, indexed by peak number
@@ -28,6 +27,32 @@ MajorPeaks::MajorPeaks(int n)
     output          = new float*[2];
     output[MP_FREQ] = new float[maxNumPeaks];
     output[MP_AMP]  = new float[maxNumPeaks];
+
+    // the heap only ever holds maxNumPeaks peaks, so it does not depend on
+    // the window size and never needs clearing
+    heapBins       = new int[maxNumPeaks];
+    heapAmplitudes = new float[maxNumPeaks];
+
+    for (int i = 0; i < maxNumPeaks; i++) {
+        output[MP_FREQ][i] = 0;
+        output[MP_AMP][i]  = 0;
+    }
+}
+
+bool MajorPeaks::isEquivalent(const AnalysisModule* other) const
+{
+    // the type check makes the cast safe
+    return AnalysisModule::isEquivalent(other)
+        && ((const MajorPeaks*)other)->maxNumPeaks == this->maxNumPeaks;
+}
+
+void MajorPeaks::storeFeatures(float* features, int stride)
+{
+    float** peaks = getOutput();
+    for (int i = 0; i < maxNumPeaks; i++) {
+        features[i * stride]                 = peaks[MP_FREQ][i];
+        features[(maxNumPeaks + i) * stride] = peaks[MP_AMP][i];
+    }
 }
 
 MajorPeaks::~MajorPeaks()
@@ -38,50 +63,79 @@ MajorPeaks::~MajorPeaks()
     delete[] output;          // free the array managing the arrays of frequencies and amplitudes
 
     // free temporary storage
-    delete[] outputFrequencies;
-    delete[] outputAmplitudes;
+    delete[] heapBins;
+    delete[] heapAmplitudes;
 }
 
-void MajorPeaks::resetPeaksArrays()
+bool MajorPeaks::isSmallerPeak(int a, int b) const
 {
-    numPeaks = 0; // reset the number of peaks to zero
+    return heapAmplitudes[a] < heapAmplitudes[b]
+        || (heapAmplitudes[a] == heapAmplitudes[b] && heapBins[a] < heapBins[b]);
+}
 
-    if (outputLength != windowSizeBy2 >> 1) {
-        delete[] outputFrequencies;
-        delete[] outputAmplitudes;
-        outputFrequencies = new float[windowSizeBy2 >> 1];
-        outputAmplitudes  = new float[windowSizeBy2 >> 1];
+void MajorPeaks::siftUp(int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) >> 1;
+        if (!isSmallerPeak(i, parent)) {
+            break;
+        }
+        std::swap(heapBins[i], heapBins[parent]);
+        std::swap(heapAmplitudes[i], heapAmplitudes[parent]);
+        i = parent;
     }
+}
 
-    // zero out the output arrays
-    for (int i = 0; i < windowSizeBy2 >> 1; i++) {
-        outputFrequencies[i] = 0;
-        outputAmplitudes[i]  = 0;
+void MajorPeaks::siftDown(int i)
+{
+    for (;;) {
+        int smallest = i;
+        int left     = 2 * i + 1;
+        int right    = left + 1;
+        if (left < numPeaks && isSmallerPeak(left, smallest)) {
+            smallest = left;
+        }
+        if (right < numPeaks && isSmallerPeak(right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        std::swap(heapBins[i], heapBins[smallest]);
+        std::swap(heapAmplitudes[i], heapAmplitudes[smallest]);
+        i = smallest;
     }
 }
 
 void MajorPeaks::findPeaks()
 {
     float* windowData = spectrogram->getCurrentWindow();
-    // iterate through the frequency range, excluding the first and last bins
 
-    int lowerFreq = lowerBinBound / freqWidth;
-    int upperFreq = upperBinBound / freqWidth;
+    numPeaks = 0;
 
-    for (int i = lowerBinBound + 1; i < upperBinBound; i++) {
-        // if the current bin is a peak, store its frequency and amplitude
+    // iterate through the frequency range, excluding only the first and last
+    // bins of the window, so both neighbors of a bin are always within the
+    // window. A range that does not reach an edge keeps its edge bins as
+    // candidates, their neighbors outside the range are still compared.
+    int lowerBin = std::max(lowerBinBound, 1);
+    int upperBin = std::min(upperBinBound, spectrogram->getNumBins() - 1);
+    for (int i = lowerBin; i < upperBin; i++) {
+        // if the current bin is a peak, keep it if it is one of the largest so far
         if (windowData[i] > windowData[i - 1]
             && windowData[i] > windowData[i + 1]) {
-            // store the frequency of the peak
-            // the index is multiplied by freqRes to convert the bin number to a frequency value
-            // freqRes is the frequency width of each bin
-            outputFrequencies[numPeaks] = i * freqRes;
-
-            // store the amplitude of the peak
-            outputAmplitudes[numPeaks] = windowData[i];
-
-            // increment the number of peaks found to reflect the addition of this peak
-            numPeaks++;
+            if (numPeaks < maxNumPeaks) {
+                // the heap is not full yet, add the peak
+                heapBins[numPeaks]       = i;
+                heapAmplitudes[numPeaks] = windowData[i];
+                siftUp(numPeaks);
+                numPeaks++;
+            } else if (maxNumPeaks > 0 && windowData[i] >= heapAmplitudes[0]) {
+                // the peak replaces the smallest kept peak
+                // a later peak of equal amplitude is larger, as its frequency is higher
+                heapBins[0]       = i;
+                heapAmplitudes[0] = windowData[i];
+                siftDown(0);
+            }
 
             if (debugMode & DEBUG_VERBOSE) {
                 Serial.printf("    - [%d, %03g]\n", i, windowData[i]);
@@ -92,40 +146,27 @@ void MajorPeaks::findPeaks()
     }
 }
 
-void MajorPeaks::trimPeaks()
+void MajorPeaks::storePeaks()
 {
-    // loop until numPeaks <= maxNumPeaks, removing the smallest peak each iteration
-    while (numPeaks > maxNumPeaks) {
-        float minAmp   = outputAmplitudes[0];
-        int   minIndex = 0;
-
-        // iterate through the peaks, storing the index of the peak with the smallest amplitude
-        // the peak at this index will be removed in the next step
-        for (int i = 1; i < numPeaks; i++) {
-            if (outputAmplitudes[i] < minAmp) {
-                minAmp   = outputAmplitudes[i];
-                minIndex = i;
-            }
+    // insertion sort of the kept peaks by bin, at most maxNumPeaks of them
+    for (int i = 1; i < numPeaks; i++) {
+        int   bin       = heapBins[i];
+        float amplitude = heapAmplitudes[i];
+        int   j         = i - 1;
+        for (; j >= 0 && heapBins[j] > bin; j--) {
+            heapBins[j + 1]       = heapBins[j];
+            heapAmplitudes[j + 1] = heapAmplitudes[j];
         }
-
-        // remove the peak with the smallest amplitude
-        // removal is done by shifting all elements after the removed peak one index to the left
-        for (int i = minIndex; i < numPeaks - 1; i++) {
-            outputFrequencies[i] = outputFrequencies[i + 1];
-            outputAmplitudes[i]  = outputAmplitudes[i + 1];
-        }
-        numPeaks--;
+        heapBins[j + 1]       = bin;
+        heapAmplitudes[j + 1] = amplitude;
     }
-}
 
-void MajorPeaks::storePeaks()
-{
-    // copy peaks from temporary storage to the actual output arrays
     for (int i = 0; i < maxNumPeaks; i++) {
         // if there are fewer than maxNumPeaks peaks, pad array with zeros
         if (i < numPeaks) {
-            output[MP_FREQ][i] = outputFrequencies[i];
-            output[MP_AMP][i]  = outputAmplitudes[i];
+            // the index is multiplied by freqRes to convert the bin number to a frequency value
+            output[MP_FREQ][i] = heapBins[i] * freqRes;
+            output[MP_AMP][i]  = heapAmplitudes[i];
         } else {
             output[MP_FREQ][i] = 0;
             output[MP_AMP][i]  = 0;
@@ -152,9 +193,7 @@ void MajorPeaks::doAnalysis()
         Serial.printf("===MAJORPEAKS===\n");
     }
 
-    resetPeaksArrays();
     findPeaks();
-    trimPeaks();
     storePeaks();
 
     // if debug is enabled, print the output to the serial console
@@ -15,7 +15,7 @@
  * peak. If there are fewer than N peaks, the remaining elements in the array
  * are padded with zeros.
  */
-class MajorPeaks : public ModuleInterface<float**> {
+class MajorPeaks final : public ModuleInterface<float**> {
 public:
     // default constructor the sets the number of peaks to 4
     MajorPeaks();
@@ -27,47 +27,52 @@ public:
     // frees memory allocated for the output arrays and temporary storage
     ~MajorPeaks();
 
-    // perform the 4 step analysis
-    // 1. resetPeaksArrays() to clear the temporary storage and output arrays, and reset the number of peaks found
-    // 2. findPeaks() to find all peaks in the current window (up to windowSizeBy2>>1 peaks)
-    // 3. trimPeaks() to remove the smallest peaks until numPeaks <= maxNumPeaks
-    // 4. storePeaks() to copy peaks from temporary storage to the actual output arrays
+    // perform the 2 step analysis
+    // 1. findPeaks() to keep the maxNumPeaks largest peaks in the current window
+    // 2. storePeaks() to copy them to the output arrays in order of frequency
     // this is the function called by the analysis manager to perform the analysis
     // the output is a 2d array of floats, where output[0] is an array of frequencies and output[1] is an array of amplitudes
     // the output is indexed by peak number, and is always in order of lowest freq peak to highest freq peak
     void doAnalysis();
 
+    // equivalent MajorPeaks modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<MajorPeaks>(); };
+    bool        isEquivalent(const AnalysisModule* other) const;
+
+    // the frequencies of the peaks are stored as the first maxNumPeaks features
+    // in a feature matrix, followed by their amplitudes
+    int  getNumFeatures() { return maxNumPeaks * 2; };
+    void storeFeatures(float* features, int stride);
+
 private:
     int maxNumPeaks = 4; // default number of peaks to find
-    int numPeaks    = 0; // number of peaks found this iteration
+    int numPeaks    = 0; // number of peaks kept this iteration
+
+    // the largest peaks found so far, as a min-heap of maxNumPeaks bins
+    // ordered by amplitude, then by bin, so the smallest kept peak is at the root
+    int*   heapBins;
+    float* heapAmplitudes;
 
-    // temporary storage for calculating the output
-    int    outputLength      = windowSizeBy2 >> 1;
-    float* outputFrequencies = new float[windowSizeBy2 >> 1];
-    float* outputAmplitudes  = new float[windowSizeBy2 >> 1];
+    // allocates the output arrays and the heap for maxNumPeaks peaks
+    void allocatePeaks();
 
-    // reset peaks arrays
-    // this function is called at the beginning of each call to perform analysis
-    // the number of peaks is reset to zero, and the arrays are zeroed out
-    // the arrays must be reset to zero to avoid storing peaks from previous analysis calls
-    void resetPeaksArrays();
+    // whether the peak at heap index a is smaller than the peak at heap index b
+    // of two peaks with the same amplitude, the lower frequency one is smaller
+    bool isSmallerPeak(int a, int b) const;
 
-    // find all peaks in the current window
+    // restore the heap order after a peak is added at, or replaces, index i
+    void siftUp(int i);
+    void siftDown(int i);
+
+    // find the maxNumPeaks largest peaks in the current window in a single pass
     // a peak is a freq. bin whose amplitude is greater than its neighbors
-    // this function does not limit itself to finding maxNumPeaks peaks
-    // if more than maxNumPeaks peaks are found, the smallest peaks are removed with trimPeaks later
-    // if fewer than maxNumPeaks peaks are found, the remaining peaks are padded with zeros
-    // this function should only be called after resetPeaksArrays()
+    // the first and last bins of the window are not peaks, the edge bins of a
+    // narrower analysis range are, compared with neighbors outside the range
+    // each peak is added to the heap while it holds fewer than maxNumPeaks
+    // peaks, afterwards it replaces the smallest kept peak if it is larger
     void findPeaks();
 
-    // remove the smallest peaks until numPeaks <= maxNumPeaks
-    // if there are equal to or fewer than maxNumPeaks peaks, this function does nothing
-    // this function is called directly after findPeaks()
-    // larger peaks are shifted to the left in the temporary storage arrays to overwrite smaller peaks
-    void trimPeaks();
-
-    // storePeaks() copies peaks from temporary storage to the actual output arrays
-    // this fuction is called after trimPeaks(), so there can only be up to maxNumPeaks peaks to store
+    // storePeaks() sorts the kept peaks by frequency into the output arrays
     // if there are fewer than maxNumPeaks peaks, the remaining elements are padded with zeros
     void storePeaks();
 
@@ -2,19 +2,9 @@
 
 void MaxAmplitude::doAnalysis()
 {
-    float* windowData = spectrogram->getCurrentWindow();
-
-    // initialize max to 0 (there cannot be negative amplitudes)
-    float max = 0.0;
-
-    // iterate through the bins in the selected frequency range
-    // if a bin's amplitude is greater than max, update max
-    // at the end of the loop, max will contain the amplitude of the highest bin
-    for (int i = lowerBinBound; i < upperBinBound; i++) {
-        if (windowData[i] > max) {
-            max = windowData[i];
-        }
-    }
+    // find the amplitude of the highest bin in the selected frequency range
+    // the value is shared through the spectrogram's feature cache
+    float max = spectrogram->getFeatures()->getMax(lowerBinBound, upperBinBound);
 
     // store the max amplitude in the output variable
     // the output of this module can be retrieved by calling getOutput() after analysis
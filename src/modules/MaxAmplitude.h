@@ -11,15 +11,71 @@
 #ifndef Max_Amplitude_h
 #define Max_Amplitude_h
 
+#include "../AnalysisContext.h"
 #include "../AnalysisModule.h"
+#include "../FixedPoint.h"
+#include "../SpectralTools.h"
 
 // MaxAmplitude inherits from the ModuleInterface with a float output type
-class MaxAmplitude : public ModuleInterface<float> {
+class MaxAmplitude final : public ModuleInterface<float> {
 public:
     // doAnalysis() is called by the analysis manager
     // it finds the frequency bin with the highest amplitude in the current window
     // the max amplitude is stored in the module's output variable
     void doAnalysis();
+
+    // equivalent MaxAmplitude modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<MaxAmplitude>(); };
+};
+
+// FixedMaxAmplitude is a MaxAmplitude whose audio context and frequency range
+// are fixed at compile time, see AnalysisContext.h
+template <class Context = FixedContext<>>
+class FixedMaxAmplitude : public FixedModuleInterface<float, Context> {
+public:
+    void doAnalysis()
+    {
+        float* windowData = this->spectrogram->getCurrentWindow();
+        this->output      = AudioPrism::fixed_max<Context::numBins>(windowData + Context::lowerBin);
+
+        // if debug is enabled, print the output to the serial console
+        if (this->debugMode & DEBUG_ENABLE) {
+            Serial.printf("===MAX_AMPLITUDE===\n");
+            if (this->debugMode & DEBUG_VERBOSE) {
+                this->printModuleInfo();
+            }
+            Serial.printf("Max: %f\n", this->output);
+            Serial.printf("===================\n");
+        }
+    }
+};
+
+// MaxAmplitudeQ15 is a MaxAmplitude of the integer analysis path, see
+// FixedPoint.h. It reads a SpectrogramQ15, and outputs the Q15 max amplitude
+class MaxAmplitudeQ15 : public Q15ModuleInterface<AudioPrism::q15_t> {
+public:
+    void doAnalysis()
+    {
+        const AudioPrism::q15_t* windowData = this->spectrogramQ15->getCurrentWindow();
+
+        AudioPrism::q15_t maxVal = 0;
+        for (int i = this->lowerBinBound; i < this->upperBinBound; i++) {
+            if (windowData[i] > maxVal) {
+                maxVal = windowData[i];
+            }
+        }
+        this->output = maxVal;
+
+        // if debug is enabled, print the output to the serial console
+        if (this->debugMode & DEBUG_ENABLE) {
+            Serial.printf("===MAX_AMPLITUDE_Q15===\n");
+            if (this->debugMode & DEBUG_VERBOSE) {
+                this->printModuleInfo();
+            }
+            Serial.printf("Max: %d\n", this->output);
+            Serial.printf("=======================\n");
+        }
+    }
 };
 
 #endif
@@ -11,7 +11,7 @@ MeanAmplitude::MeanAmplitude()
 void MeanAmplitude::doAnalysis()
 {
     // perform analysis on the totalamplitude module
-    totalAmp.doAnalysis();
+    totalAmp.analyze();
 
     // retrieve the output of the totalamplitude module
     float total = totalAmp.getOutput();
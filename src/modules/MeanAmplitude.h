@@ -15,7 +15,7 @@
 
 // MeanAmplitude inherits from the ModuleInterface with a float output typ
 // this module contains one submodule, TotalAmplitude
-class MeanAmplitude : public ModuleInterface<float> {
+class MeanAmplitude final : public ModuleInterface<float> {
 private:
     // submodules are made private so they cannot be accessed outside of the parent module
     // submodules must be registered with their parents in a constructor method
@@ -36,5 +36,61 @@ public:
     // the totalamplitude submodule is invoked to calculate the total amplitude of the current window
     // the mean amplitude is calculated from the total amplitude and the number of bins in the selected frequency range
     void doAnalysis();
+
+    // equivalent MeanAmplitude modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<MeanAmplitude>(); };
+};
+
+// FixedMeanAmplitude is a MeanAmplitude whose audio context and frequency
+// range are fixed at compile time, see AnalysisContext.h
+// the bin count is constant, so no submodule is needed to find the total
+template <class Context = FixedContext<>>
+class FixedMeanAmplitude : public FixedModuleInterface<float, Context> {
+    static_assert(Context::numBins > 0, "MeanAmplitude needs at least one bin.");
+
+public:
+    void doAnalysis()
+    {
+        float* windowData = this->spectrogram->getCurrentWindow();
+        float  total      = AudioPrism::fixed_sum<Context::numBins>(windowData + Context::lowerBin);
+        this->output      = total * (1.0f / Context::numBins);
+
+        // if debug is enabled, print the output to the serial console
+        if (this->debugMode & DEBUG_ENABLE) {
+            Serial.printf("===MEAN_AMPLITUDE===\n");
+            if (this->debugMode & DEBUG_VERBOSE) {
+                this->printModuleInfo();
+            }
+            Serial.printf("Mean: %f\n", this->output);
+            Serial.printf("====================\n");
+        }
+    }
+};
+
+// MeanAmplitudeQ15 is a MeanAmplitude of the integer analysis path, see
+// FixedPoint.h. It reads a SpectrogramQ15, and outputs the Q15 mean amplitude
+class MeanAmplitudeQ15 : public Q15ModuleInterface<AudioPrism::q15_t> {
+public:
+    void doAnalysis()
+    {
+        const AudioPrism::q15_t* windowData = this->spectrogramQ15->getCurrentWindow();
+
+        int32_t total   = 0;
+        int     numBins = this->upperBinBound - this->lowerBinBound;
+        for (int i = this->lowerBinBound; i < this->upperBinBound; i++) {
+            total += windowData[i];
+        }
+        this->output = numBins > 0 ? AudioPrism::q15_t(total / numBins) : 0;
+
+        // if debug is enabled, print the output to the serial console
+        if (this->debugMode & DEBUG_ENABLE) {
+            Serial.printf("===MEAN_AMPLITUDE_Q15===\n");
+            if (this->debugMode & DEBUG_VERBOSE) {
+                this->printModuleInfo();
+            }
+            Serial.printf("Mean: %d\n", this->output);
+            Serial.printf("========================\n");
+        }
+    }
 };
 #endif
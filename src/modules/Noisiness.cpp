@@ -1,31 +1,12 @@
 #include "Noisiness.h"
 
-Noisiness::Noisiness()
-{
-    this->addSubmodule(&totalAmp); // register the TotalAmplitude submodule
-}
-
 void Noisiness::doAnalysis()
 {
-    totalAmp.doAnalysis();              // perform analysis with the TotalAmplitude submodule
-    float total = totalAmp.getOutput(); // retrieve the output of the TotalAmplitude submodule
-
-    float* windowData = spectrogram->getCurrentWindow();
-
-    float entropy = 0;
-    // for each bin, calculate the contribution to the overall entropy
-    for (int i = lowerBinBound; i < upperBinBound; i++) {
-        // if the amplitude of the current bin is zero, skip it (log2(0) is undefined)
-        if (windowData[i] > 0) {
-            // assign a probability to each bin based on its amplitude
-            float p = windowData[i] / total;
-            // calculate the contribution of this bin to the entropy
-            entropy -= p * log2(p);
-        }
-    }
-
-    // Normalize the entropy to a 0.-1. scale
-    output = entropy / log2(upperBinBound - lowerBinBound);
+    // the entropy of the current window, treating the normalized amplitudes
+    // of the bins as a probability distribution, normalized to a 0.-1. scale
+    // the entropy and the amplitude sum it depends on are computed in a
+    // single pass and shared through the spectrogram's feature cache
+    output = spectrogram->getFeatures()->getEntropy(lowerBinBound, upperBinBound);
 
     // if debug is enabled, print the output to the serial console
     if (debugMode & DEBUG_ENABLE) {
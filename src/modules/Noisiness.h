@@ -13,7 +13,8 @@
 //               entropy of the normalized amplitude spectrum. This is a
 //               measure of the amount of the randomness / unpredictability in
 //               the current window, treating the normalized amplitude
-//               spectrum as a probability distribution.
+//               spectrum as a probability distribution. Empty bins do not
+//               contribute, and a silent window has a noisiness of 0.
 //============================================================================
 
 #ifndef Noisiness_h
@@ -22,27 +23,39 @@
 #include <math.h>
 
 #include "../AnalysisModule.h"
-#include "TotalAmplitude.h"
+#include "../FixedPoint.h"
 
 // the Noisiness module inherits from the ModuleInterface with a float output type
-// this module has one submodule, TotalAmplitude
-class Noisiness : public ModuleInterface<float> {
-private:
-    // submodules are made private so they cannot be accessed outside of the parent module
+class Noisiness final : public ModuleInterface<float> {
+public:
+    void doAnalysis();
 
-    // the TotalAmplitude submodule outputs the sum of the amplitudes of the frequency bins in the current window
-    // the TotalAmplitude submodule is used to normalize the bin amplitudes
-    // normalized bin amplitudes are necessary for calculating the entropy of the current window
-    TotalAmplitude totalAmp = TotalAmplitude();
+    // equivalent Noisiness modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<Noisiness>(); };
+};
 
+// NoisinessQ15 is a Noisiness of the integer analysis path, see FixedPoint.h
+// It reads a SpectrogramQ15, and outputs the normalized entropy in Q15, with
+// the logarithms taken by an integer log2 instead of log2f()
+class NoisinessQ15 : public Q15ModuleInterface<AudioPrism::q15_t> {
 public:
-    // constructor
-    // a constructor is necessary for modules containing submodules
-    // submodules must be registered with the parent in the constructor
-    // registering submodules with a parent module allows automatic propagation of the parent's window bounds to the submodules
-    Noisiness();
-
-    void doAnalysis();
+    void doAnalysis()
+    {
+        AudioPrism::SpectralStatsQ15 stats;
+        AudioPrism::spectral_stats_q15(this->spectrogramQ15->getCurrentWindow(), NULL,
+            this->lowerBinBound, this->upperBinBound, stats, true);
+        this->output = stats.entropy;
+
+        // if debug is enabled, print the output to the serial console
+        if (this->debugMode & DEBUG_ENABLE) {
+            Serial.printf("===NOISINESS_Q15===\n");
+            if (this->debugMode & DEBUG_VERBOSE) {
+                this->printModuleInfo();
+            }
+            Serial.printf("Noise: %d\n", this->output);
+            Serial.printf("===================\n");
+        }
+    }
 };
 
 #endif
@@ -17,6 +17,7 @@ void PercussionDetection::setEnergyThreshold(float new_threshold)
     } else {
         energy_threshold = new_threshold;
     }
+    parametersChanged();
 }
 
 void PercussionDetection::setFluxThreshold(float new_threshold)
@@ -28,6 +29,7 @@ void PercussionDetection::setFluxThreshold(float new_threshold)
     } else {
         flux_threshold = new_threshold;
     }
+    parametersChanged();
 }
 
 void PercussionDetection::setEntropyThreshold(float new_threshold)
@@ -39,38 +41,35 @@ void PercussionDetection::setEntropyThreshold(float new_threshold)
     } else {
         entropy_threshold = new_threshold;
     }
+    parametersChanged();
 }
 
-void PercussionDetection::doAnalysis()
+bool PercussionDetection::isEquivalent(const AnalysisModule* other) const
 {
-    float* currWindow = spectrogram->getCurrentWindow();
-    float* prevWindow = spectrogram->getPreviousWindow();
-
-    int   lowerFreq = lowerBinBound / freqWidth;
-    int   upperFreq = upperBinBound / freqWidth;
-    float totalAmp  = AudioPrism::sum(currWindow, lowerFreq, upperFreq);
-
-    float flux    = 0.;
-    float energy  = 0.;
-    float entropy = 0.;
-    for (int i = lowerBinBound; i < upperBinBound; ++i) {
-        // calculate flux (only finding an increase in amplitude)
-        float pos_diff = currWindow[i] - prevWindow[i];
-        if (pos_diff < 0) {
-            pos_diff = 0;
-        }
-        flux += pow(pos_diff, 2);
+    if (!AnalysisModule::isEquivalent(other)) {
+        return false;
+    }
 
-        // calculate energy
-        energy += pow(currWindow[i], 2);
+    // the type check makes the cast safe
+    const PercussionDetection* peer = (const PercussionDetection*)other;
+    return peer->flux_threshold == this->flux_threshold
+        && peer->energy_threshold == this->energy_threshold
+        && peer->entropy_threshold == this->entropy_threshold;
+}
 
-        // calculate entropy
-        float p = (currWindow[i] + 1e-12) / (totalAmp + 1e-10);
-        entropy += p * -(std::log2(p));
-    }
+void PercussionDetection::doAnalysis()
+{
+    // flux, energy and entropy are shared through the spectrogram's feature
+    // cache, so other modules analyzing the same range reuse them
+    // requesting the entropy first computes all three in a single pass
+    FeatureCache* features = spectrogram->getFeatures();
+
+    float entropy = features->getEntropy(lowerBinBound, upperBinBound);
+    float energy  = features->getEnergy(lowerBinBound, upperBinBound);
+    // flux only considers increases in amplitude
+    float flux = features->getPositiveFlux(lowerBinBound, upperBinBound);
 
     flux /= (energy + 1e-10);
-    entropy /= std::log2(upperBinBound - lowerBinBound);
 
     // predict percussion is present if all three submodule's outputs are above their threshold values
     // an output of true indicates that percussion is predicted to be present in the current window
@@ -96,3 +95,68 @@ void PercussionDetection::doAnalysis()
         }
     }
 }
+
+// clamps a threshold to the 0-1 range, so the conversions cannot overflow
+static float clamp_threshold(float threshold)
+{
+    if (threshold < 0) {
+        return 0;
+    } else if (threshold > 1) {
+        return 1;
+    }
+    return threshold;
+}
+
+PercussionDetectionQ15::PercussionDetectionQ15(float flux_threshold, float energy_threshold, float entropy_threshold)
+{
+    // set the threshold values
+    this->setFluxThreshold(flux_threshold);
+    this->setEnergyThreshold(energy_threshold);
+    this->setEntropyThreshold(entropy_threshold);
+}
+
+void PercussionDetectionQ15::setFluxThreshold(float new_threshold)
+{
+    flux_threshold = clamp_threshold(new_threshold) * AudioPrism::Q15_ONE;
+}
+
+void PercussionDetectionQ15::setEnergyThreshold(float new_threshold)
+{
+    energy_threshold = clamp_threshold(new_threshold) * float(uint32_t(1) << 30);
+}
+
+void PercussionDetectionQ15::setEntropyThreshold(float new_threshold)
+{
+    entropy_threshold = clamp_threshold(new_threshold) * AudioPrism::Q15_ONE;
+}
+
+void PercussionDetectionQ15::doAnalysis()
+{
+    // flux only considers increases in amplitude, and is compared relative to
+    // the energy without a division: flux / energy > threshold is
+    // flux * 2^15 > threshold * energy in Q15
+    AudioPrism::SpectralStatsQ15 stats;
+    AudioPrism::spectral_stats_q15(spectrogramQ15->getCurrentWindow(),
+        spectrogramQ15->getNonOverlappingWindow(), lowerBinBound, upperBinBound, stats, true);
+
+    bool fluxAbove = (stats.positiveFlux << 15) > (uint64_t)flux_threshold * stats.energy;
+
+    // predict percussion is present if all three features are above their threshold values
+    output = fluxAbove && (stats.entropy > entropy_threshold) && (stats.energy > energy_threshold);
+
+    // if debug is enabled, print the output to the serial console
+    if (debugMode & DEBUG_ENABLE) {
+        Serial.printf("===PERCUSSION_DETECTION_Q15===\n");
+        if (debugMode & DEBUG_VERBOSE) {
+            printModuleInfo();
+        }
+        Serial.printf("Flux:     %llu\n", (unsigned long long)stats.positiveFlux);
+        Serial.printf("Energy:   %llu\n", (unsigned long long)stats.energy);
+        Serial.printf("Entropy:  %d\n", stats.entropy);
+        Serial.printf("==============================\n");
+
+        if (output) {
+            Serial.printf("!!! Percussion Detected !!!\n");
+        }
+    }
+}
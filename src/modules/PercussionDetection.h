@@ -30,13 +30,18 @@
 //               detection accuracy. Mid and low frequencies are often
 //               cluttered with periodic elements, which can obscure
 //               percussion or trigger false positives.
+//
+//               With overlapping windows (see STFT), the flux is measured
+//               against the last window that does not overlap the current
+//               one, so the thresholds do not depend on the hop size, and a
+//               transient is detected within one hop.
 //============================================================================
 
 #ifndef PERCUSSION_DETECTION_H
 #define PERCUSSION_DETECTION_H
 
 #include "../AnalysisModule.h"
-#include "HardwareSerial.h"
+#include "../FixedPoint.h"
 #include "../SpectralTools.h"
 
 // PercussionDetection inherits from the ModuleInterface with a bool output type
@@ -46,7 +51,7 @@
 //              (percussion is expected to have a high delta amplitude compared to sustained audio)
 // Submodule 3: Noisiness -- an indicator of the noisiness of the current window
 //              (percussion is expected to be noisier than periodic instruments like synths, pianos, strings, etc.)
-class PercussionDetection : public ModuleInterface<bool> {
+class PercussionDetection final : public ModuleInterface<bool> {
 private:
     // the loudness threshold is the minimum amplitude required for a window to be considered percussive
     float energy_threshold = 1800000.0;
@@ -81,6 +86,41 @@ public:
     void setEntropyThreshold(float new_threshold);
 
     void doAnalysis();
+
+    // equivalent PercussionDetection modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<PercussionDetection>(); };
+    bool        isEquivalent(const AnalysisModule* other) const;
+};
+
+// PercussionDetectionQ15 is a PercussionDetection of the integer analysis
+// path, see FixedPoint.h. It reads a SpectrogramQ15, and computes its flux,
+// energy and entropy in one pass of spectral_stats_q15(), so a frame uses no
+// floating point operations at all
+// the thresholds are set as floats in the units of the Q15 magnitudes (an
+// energy of 1.0 is a single full scale bin) and converted once when set
+class PercussionDetectionQ15 : public Q15ModuleInterface<bool> {
+private:
+    // minimum ratio of the positive flux to the energy, in Q15
+    int32_t flux_threshold = AudioPrism::Q15_ONE / 2;
+
+    // minimum energy, in Q30
+    uint64_t energy_threshold = uint64_t(1) << 30;
+
+    // minimum normalized entropy, in Q15
+    int32_t entropy_threshold = AudioPrism::Q15_ONE * 3 / 4;
+
+public:
+    PercussionDetectionQ15() { }
+
+    // constructor with parameters for the threshold values, see PercussionDetection
+    PercussionDetectionQ15(float flux_threshold, float energy_threshold, float entropy_threshold);
+
+    // set the thresholds (0-1), see PercussionDetection
+    void setFluxThreshold(float new_threshold);
+    void setEnergyThreshold(float new_threshold);
+    void setEntropyThreshold(float new_threshold);
+
+    void doAnalysis();
 };
 
 #endif // PERCUSSION_DETECTION_H
@@ -1,10 +1,13 @@
 #include "SalientFreqs.h"
 
+#include <utility>
+
 SalientFreqs::SalientFreqs()
 {
     numFreqs     = 3; // default to finding frequency of max change
     direction    = 0;
     salientFreqs = new int[numFreqs];
+    saliences    = new float[numFreqs];
     this->addSubmodule(&deltaAmps);
 
     for (int i = 0; i < numFreqs; i++) {
@@ -24,6 +27,7 @@ SalientFreqs::SalientFreqs(int n)
     numFreqs     = n;
     direction    = 0;
     salientFreqs = new int[numFreqs];
+    saliences    = new float[numFreqs];
     this->addSubmodule(&deltaAmps);
 
     for (int i = 0; i < numFreqs; i++) {
@@ -49,6 +53,7 @@ SalientFreqs::SalientFreqs(int n, int dir)
 
     numFreqs     = n;
     salientFreqs = new int[numFreqs];
+    saliences    = new float[numFreqs];
     this->addSubmodule(&deltaAmps);
 
     for (int i = 0; i < numFreqs; i++) {
@@ -59,24 +64,48 @@ SalientFreqs::SalientFreqs(int n, int dir)
 SalientFreqs::~SalientFreqs()
 {
     delete[] salientFreqs;
+    delete[] saliences;
 }
 
 void SalientFreqs::changeNumFreqs(int newSize)
 {
     numFreqs = newSize;
     delete[] salientFreqs;
+    delete[] saliences;
     salientFreqs = new int[numFreqs];
+    saliences    = new float[numFreqs];
+    parametersChanged();
 }
 
 void SalientFreqs::changeDirction(int dir)
 {
     direction = dir;
+    parametersChanged();
+}
+
+bool SalientFreqs::isEquivalent(const AnalysisModule* other) const
+{
+    if (!AnalysisModule::isEquivalent(other)) {
+        return false;
+    }
+
+    // the type check makes the cast safe
+    const SalientFreqs* peer = (const SalientFreqs*)other;
+    return peer->numFreqs == this->numFreqs && peer->direction == this->direction;
+}
+
+void SalientFreqs::storeFeatures(float* features, int stride)
+{
+    int* bins = getOutput();
+    for (int i = 0; i < numFreqs; i++) {
+        features[i * stride] = bins[i];
+    }
 }
 
 bool SalientFreqs::checkDirection(int idx)
 {
     float* current_window = spectrogram->getCurrentWindow();
-    float* prev_window    = spectrogram->getPreviousWindow();
+    float* prev_window    = spectrogram->getNonOverlappingWindow();
     if (direction == 1 && current_window[idx] > prev_window[idx])
         return false;
     if (direction == 2 && current_window[idx] < prev_window[idx])
@@ -84,27 +113,90 @@ bool SalientFreqs::checkDirection(int idx)
     return true;
 }
 
+bool SalientFreqs::isLessSalient(int a, int b) const
+{
+    // of two bins with the same change, the higher one is less salient
+    return saliences[a] < saliences[b]
+        || (saliences[a] == saliences[b] && salientFreqs[a] > salientFreqs[b]);
+}
+
+void SalientFreqs::siftDown(int i, int numFound)
+{
+    for (;;) {
+        int least = i;
+        int left  = 2 * i + 1;
+        int right = left + 1;
+        if (left < numFound && isLessSalient(left, least)) {
+            least = left;
+        }
+        if (right < numFound && isLessSalient(right, least)) {
+            least = right;
+        }
+        if (least == i) {
+            break;
+        }
+        std::swap(salientFreqs[i], salientFreqs[least]);
+        std::swap(saliences[i], saliences[least]);
+        i = least;
+    }
+}
+
 void SalientFreqs::doAnalysis()
 {
-    deltaAmps.doAnalysis();
-    amplitudes = deltaAmps.getOutput(); // copy amplitudes
+    deltaAmps.analyze();
 
-    // iterate through amplitudes to find the maximum(s)
-    int currMaxAmp    = 0;
-    int currMaxAmpIdx = -1;
-    for (int i = 0; i < numFreqs; i++) {
-        for (int j = lowerBinBound; j < upperBinBound; j++) {
-            if (amplitudes[j] > currMaxAmp) {
-                if (checkDirection(j)) {
-                    currMaxAmp    = amplitudes[j];
-                    currMaxAmpIdx = j;
-                }
+    // the delta amplitudes may be shared with other modules, they are only read
+    const float* deltas         = deltaAmps.getOutput();
+    const float* current_window = spectrogram->getCurrentWindow();
+    const float* prev_window    = spectrogram->getNonOverlappingWindow();
+
+    // a single pass over the bins keeps the numFreqs largest changes in a
+    // min-heap, with the least salient kept bin at the root
+    int numFound = 0;
+    for (int j = lowerBinBound; j < upperBinBound && numFreqs > 0; j++) {
+        float delta = deltas[j];
+        // bins that did not change, or changed in the wrong direction, are skipped
+        if (!(delta > 0)
+            || (direction == 1 && current_window[j] > prev_window[j])
+            || (direction == 2 && current_window[j] < prev_window[j])) {
+            continue;
+        }
+
+        if (numFound < numFreqs) {
+            // the heap is not full yet, add the bin and sift it up
+            int i = numFound++;
+            salientFreqs[i] = j;
+            saliences[i]    = delta;
+            while (i > 0 && isLessSalient(i, (i - 1) >> 1)) {
+                std::swap(salientFreqs[i], salientFreqs[(i - 1) >> 1]);
+                std::swap(saliences[i], saliences[(i - 1) >> 1]);
+                i = (i - 1) >> 1;
             }
+        } else if (delta > saliences[0]) {
+            // the bin replaces the least salient kept bin, a later bin with the
+            // same change is less salient, as its frequency is higher
+            salientFreqs[0] = j;
+            saliences[0]    = delta;
+            siftDown(0, numFound);
+        }
+    }
+
+    // insertion sort of the kept bins from most to least salient
+    for (int i = 1; i < numFound; i++) {
+        int   bin      = salientFreqs[i];
+        float salience = saliences[i];
+        int   k        = i - 1;
+        for (; k >= 0 && (saliences[k] < salience || (saliences[k] == salience && salientFreqs[k] > bin)); k--) {
+            salientFreqs[k + 1] = salientFreqs[k];
+            saliences[k + 1]    = saliences[k];
         }
-        salientFreqs[i]           = currMaxAmpIdx; // add the new max amp index to the array
-        amplitudes[currMaxAmpIdx] = 0;             // set the amp to 0 so it will not be found again
-        currMaxAmp                = 0;             // reset iterators
-        currMaxAmpIdx             = -1;
+        salientFreqs[k + 1] = bin;
+        saliences[k + 1]    = salience;
+    }
+
+    // if fewer bins changed, the remaining elements are -1
+    for (int i = numFound; i < numFreqs; i++) {
+        salientFreqs[i] = -1;
     }
     output = salientFreqs;
 
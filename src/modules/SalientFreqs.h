@@ -16,7 +16,7 @@
 #include "DeltaAmplitudes.h"
 
 // SalientFreqs inherits from the ModuleInterface with an int* output type
-class SalientFreqs : public ModuleInterface<int*> {
+class SalientFreqs final : public ModuleInterface<int*> {
 public:
     SalientFreqs();
 
@@ -36,15 +36,30 @@ public:
     bool checkDirection(int idx);
 
     // finds the n (numFreqs) bins with highest change in amplitude, stored in salientFreqs[]
-    // input is assumed to be a 2D array of FFT data passed in from the Vibrosonics class
+    // from most to least salient, in a single pass over the analysis range
+    // bins that did not change, or changed against the direction, are never salient
     void doAnalysis();
 
+    // equivalent SalientFreqs modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<SalientFreqs>(); };
+    bool        isEquivalent(const AnalysisModule* other) const;
+
+    // each salient bin index is one feature in a feature matrix
+    int  getNumFeatures() { return numFreqs; };
+    void storeFeatures(float* features, int stride);
+
 private:
     int             numFreqs;
     int             direction;
     int*            salientFreqs;
-    float*          amplitudes;
+    float*          saliences; // change in amplitude of each bin in salientFreqs
     DeltaAmplitudes deltaAmps = DeltaAmplitudes();
+
+    // whether the bin at index a of salientFreqs is less salient than the bin at index b
+    bool isLessSalient(int a, int b) const;
+
+    // restore the min-heap order of the first numFound bins after index i is replaced
+    void siftDown(int i, int numFound);
 };
 
 #endif
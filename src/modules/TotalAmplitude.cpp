@@ -2,16 +2,10 @@
 
 void TotalAmplitude::doAnalysis()
 {
-    float* windowData = spectrogram->getCurrentWindow();
-
-    // initialize total to 0, the minimum possible amplitude sum
-    float total = 0.0;
-
-    // iterate through the bins in the selected frequency range, adding the amplitude of each bin to the total
-    for (int i = lowerBinBound; i < upperBinBound; i++) {
-        // total += curWindow[i];
-        total += windowData[i];
-    }
+    // the sum of the amplitudes of the bins in the selected frequency range
+    // is shared through the spectrogram's feature cache, so it is only
+    // computed once per frame no matter how many modules ask for it
+    float total = spectrogram->getFeatures()->getSum(lowerBinBound, upperBinBound);
 
     // store the total amplitude in the output variable
     // the output of this module can be retrieved by calling getOutput() after analysis
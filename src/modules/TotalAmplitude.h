@@ -10,16 +10,75 @@
 #ifndef Total_Amplitude_h
 #define Total_Amplitude_h
 
+#include "../AnalysisContext.h"
 #include "../AnalysisModule.h"
+#include "../FixedPoint.h"
+#include "../SpectralTools.h"
 
 // TotalAmplitude inherits from the ModuleInterface with a float output type
-class TotalAmplitude : public ModuleInterface<float> {
+class TotalAmplitude final : public ModuleInterface<float> {
 public:
     // doAnalysis() is called by the analysis manager
     // it finds the sum of the amplitudes of the bins in the selected frequency range
     // the sum is stored in the module's output variable
     // input is a 2D array that contains the stored FFT history
     void doAnalysis();
+
+    // equivalent TotalAmplitude modules in a ModuleGroup share one analysis
+    const void* getTypeTag() const { return module_type_tag<TotalAmplitude>(); };
+};
+
+// FixedTotalAmplitude is a TotalAmplitude whose audio context and frequency
+// range are fixed at compile time, see AnalysisContext.h
+// Ex. FixedTotalAmplitude<FixedContext<WINDOW_SIZE, 16384, 300, 3000>> lowMids;
+template <class Context = FixedContext<>>
+class FixedTotalAmplitude : public FixedModuleInterface<float, Context> {
+public:
+    void doAnalysis()
+    {
+        // the bin bounds are constant, so the sum has a constant trip count
+        float* windowData = this->spectrogram->getCurrentWindow();
+        this->output      = AudioPrism::fixed_sum<Context::numBins>(windowData + Context::lowerBin);
+
+        // if debug is enabled, print the output to the serial console
+        if (this->debugMode & DEBUG_ENABLE) {
+            Serial.printf("===TOTAL_AMPLITUDE===\n");
+            if (this->debugMode & DEBUG_VERBOSE) {
+                this->printModuleInfo();
+            }
+            Serial.printf("Total: %f\n", this->output);
+            Serial.printf("=====================\n");
+        }
+    }
+};
+
+// TotalAmplitudeQ15 is a TotalAmplitude of the integer analysis path, see
+// FixedPoint.h. It reads a SpectrogramQ15, and its output is the sum of the
+// Q15 amplitudes in Q15 units (a sum of 32768 is 1.0), which cannot overflow
+// Ex. TotalAmplitudeQ15 total;
+//     total.setSpectrogram(&spectrogramQ15);
+class TotalAmplitudeQ15 : public Q15ModuleInterface<int32_t> {
+public:
+    void doAnalysis()
+    {
+        const AudioPrism::q15_t* windowData = this->spectrogramQ15->getCurrentWindow();
+
+        int32_t total = 0;
+        for (int i = this->lowerBinBound; i < this->upperBinBound; i++) {
+            total += windowData[i];
+        }
+        this->output = total;
+
+        // if debug is enabled, print the output to the serial console
+        if (this->debugMode & DEBUG_ENABLE) {
+            Serial.printf("===TOTAL_AMPLITUDE_Q15===\n");
+            if (this->debugMode & DEBUG_VERBOSE) {
+                this->printModuleInfo();
+            }
+            Serial.printf("Total: %ld\n", (long)this->output);
+            Serial.printf("=========================\n");
+        }
+    }
 };
 
 #endif
@@ -0,0 +1,608 @@
+/*
+ * @file
+ * Command-line feature extractor for WAV and raw PCM files.
+ *
+ * Streams a file through an STFT (Hamming window), a Spectrogram and a
+ * ModuleGroup, and writes the features of every window (see
+ * ModuleGroup::analyzeBatch()) as CSV or binary. Windows are analyzed in
+ * blocks of BLOCK_FRAMES, so memory use does not depend on the length of the
+ * file. Multichannel input is mixed down to mono, and samples are scaled to
+ * the 16-bit range before the FFT. The window size is fixed at compile time
+ * (WINDOW_SIZE); when the file's sample rate differs from SAMPLE_RATE, the
+ * modules are set to the file's rate.
+ *
+ * Usage: WavFeatures [options] INPUT
+ *
+ *   -m, --module SPEC   add a module to the group, may be repeated
+ *                       (default: total, centroid, noisiness, peaks=4)
+ *   -o, --output FILE   write features to FILE instead of stdout
+ *   -f, --format FMT    csv (default) or bin
+ *   --hop N             samples between the starts of windows, 1 to
+ *                       WINDOW_SIZE (default: WINDOW_SIZE, no overlap)
+ *   --raw               INPUT is headerless PCM
+ *   --rate N            sample rate of raw input (default: SAMPLE_RATE)
+ *   --channels N        channels of raw input (default: 1)
+ *   --pcm TYPE          sample type of raw input: s16 (default), s32 or f32
+ *   -q, --quiet         do not report throughput on stderr
+ *
+ * INPUT may be - to read from stdin. Module specs:
+ *
+ *   total, max, mean, centroid, noisiness, percussion, formants, deltas,
+ *   peaks[=N], salient[=N], mfcc[=N], bands=F0:F1:...:FN (band edges in Hz)
+ *
+ * CSV output has a header row and a time column (seconds at the start of the
+ * window). Binary output is consecutive rows of little-endian float32
+ * features, one row per window, without the time column.
+ */
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <AudioPrism.h>
+
+// number of windows analyzed per call to analyzeBatch()
+const int BLOCK_FRAMES = 256;
+
+const int NUM_BINS = WINDOW_SIZE >> 1;
+
+//============================================================================
+// PCM INPUT
+//============================================================================
+
+enum SampleType {
+    SAMPLE_S16,
+    SAMPLE_S24,
+    SAMPLE_S32,
+    SAMPLE_F32
+};
+
+// reads interleaved PCM from a WAV or raw file and mixes it down to mono
+class PcmReader {
+public:
+    PcmReader()
+    {
+        this->file       = NULL;
+        this->sampleRate = SAMPLE_RATE;
+        this->channels   = 1;
+        this->type       = SAMPLE_S16;
+        this->remaining  = UINT64_MAX;
+    }
+
+    ~PcmReader()
+    {
+        if (this->file != NULL && this->file != stdin) {
+            fclose(this->file);
+        }
+    }
+
+    bool open(const char* path)
+    {
+        this->file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+        if (this->file == NULL) {
+            fprintf(stderr, "Error: could not open %s\n", path);
+            return false;
+        }
+        return true;
+    }
+
+    // parses the RIFF header up to the start of the data chunk
+    bool readWavHeader()
+    {
+        uint8_t riff[12];
+        if (fread(riff, 1, 12, this->file) != 12 || memcmp(riff, "RIFF", 4) != 0
+            || memcmp(riff + 8, "WAVE", 4) != 0) {
+            fprintf(stderr, "Error: input is not a WAV file\n");
+            return false;
+        }
+
+        bool hasFormat = false;
+        for (;;) {
+            uint8_t chunk[8];
+            if (fread(chunk, 1, 8, this->file) != 8) {
+                fprintf(stderr, "Error: WAV file has no data chunk\n");
+                return false;
+            }
+            uint32_t size = readLE32(chunk + 4);
+
+            if (memcmp(chunk, "fmt ", 4) == 0) {
+                uint8_t  format[40];
+                uint32_t formatSize = size < sizeof(format) ? size : sizeof(format);
+                if (size < 16 || fread(format, 1, formatSize, this->file) != formatSize
+                    || !skip(size - formatSize + (size & 1))) {
+                    fprintf(stderr, "Error: invalid WAV format chunk\n");
+                    return false;
+                }
+                int tag          = format[0] | (format[1] << 8);
+                int bits         = format[14] | (format[15] << 8);
+                this->channels   = format[2] | (format[3] << 8);
+                this->sampleRate = readLE32(format + 4);
+
+                // WAVE_FORMAT_EXTENSIBLE stores the actual format in its subformat
+                if (tag == 0xFFFE && formatSize >= 26) {
+                    tag = format[24] | (format[25] << 8);
+                }
+
+                if (tag == 1 && bits == 16) {
+                    this->type = SAMPLE_S16;
+                } else if (tag == 1 && bits == 24) {
+                    this->type = SAMPLE_S24;
+                } else if (tag == 1 && bits == 32) {
+                    this->type = SAMPLE_S32;
+                } else if (tag == 3 && bits == 32) {
+                    this->type = SAMPLE_F32;
+                } else {
+                    fprintf(stderr, "Error: unsupported WAV format (tag %d, %d bits)\n", tag, bits);
+                    return false;
+                }
+                if (this->channels < 1 || this->channels > MAX_CHANNELS) {
+                    fprintf(stderr, "Error: unsupported number of channels (%d)\n", this->channels);
+                    return false;
+                }
+                hasFormat = true;
+            } else if (memcmp(chunk, "data", 4) == 0) {
+                if (!hasFormat) {
+                    fprintf(stderr, "Error: WAV data chunk before format chunk\n");
+                    return false;
+                }
+                // streamed WAVs may leave the size at 0 or 0xFFFFFFFF, read to EOF
+                this->remaining = (size == 0 || size == 0xFFFFFFFF) ? UINT64_MAX : size;
+                return true;
+            } else if (!skip(size + (size & 1))) {
+                fprintf(stderr, "Error: truncated WAV file\n");
+                return false;
+            }
+        }
+    }
+
+    void setRawFormat(int sampleRate, int channels, SampleType type)
+    {
+        this->sampleRate = sampleRate;
+        this->channels   = channels;
+        this->type       = type;
+    }
+
+    int getSampleRate() const { return this->sampleRate; };
+
+    // reads up to numSamples mono samples, returns the number read
+    int read(float* samples, int numSamples)
+    {
+        int frameBytes = bytesPerSample() * this->channels;
+        int read       = 0;
+
+        while (read < numSamples) {
+            int count = numSamples - read;
+            if (count > MAX_FRAMES) {
+                count = MAX_FRAMES;
+            }
+            if (uint64_t(count) * frameBytes > this->remaining) {
+                count = int(this->remaining / frameBytes);
+            }
+            if (count == 0) {
+                break;
+            }
+
+            int got = fread(this->buffer, frameBytes, count, this->file);
+            if (this->remaining != UINT64_MAX) {
+                this->remaining -= uint64_t(got) * frameBytes;
+            }
+            convert(this->buffer, got, samples + read);
+            read += got;
+
+            if (got < count) {
+                break;
+            }
+        }
+        return read;
+    }
+
+private:
+    // interleaved frames converted per fread()
+    static const int MAX_FRAMES   = 1024;
+    static const int MAX_CHANNELS = 8;
+
+    FILE*      file;
+    int        sampleRate;
+    int        channels;
+    SampleType type;
+    uint64_t   remaining;
+    uint8_t    buffer[MAX_FRAMES * MAX_CHANNELS * 4];
+
+    static uint32_t readLE32(const uint8_t* p)
+    {
+        return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+
+    int bytesPerSample() const
+    {
+        switch (this->type) {
+        case SAMPLE_S16:
+            return 2;
+        case SAMPLE_S24:
+            return 3;
+        default:
+            return 4;
+        }
+    }
+
+    // skips bytes by reading them, so pipes work too
+    bool skip(uint32_t bytes)
+    {
+        while (bytes > 0) {
+            uint32_t count = bytes < sizeof(this->buffer) ? bytes : sizeof(this->buffer);
+            if (fread(this->buffer, 1, count, this->file) != count) {
+                return false;
+            }
+            bytes -= count;
+        }
+        return true;
+    }
+
+    // scales a sample to the 16-bit range
+    float sampleAt(const uint8_t* p) const
+    {
+        switch (this->type) {
+        case SAMPLE_S16:
+            return float(int16_t(p[0] | (p[1] << 8)));
+        case SAMPLE_S24:
+            return float(int32_t((uint32_t(p[0]) << 8) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 24)) >> 8) / 256.0;
+        case SAMPLE_S32:
+            return float(int32_t(readLE32(p))) / 65536.0;
+        default: {
+            uint32_t bits = readLE32(p);
+            float    value;
+            memcpy(&value, &bits, sizeof(value));
+            return value * 32768.0;
+        }
+        }
+    }
+
+    void convert(const uint8_t* data, int numFrames, float* samples) const
+    {
+        int sampleBytes = bytesPerSample();
+        for (int i = 0; i < numFrames; i++) {
+            float mix = 0;
+            for (int c = 0; c < this->channels; c++) {
+                mix += sampleAt(data);
+                data += sampleBytes;
+            }
+            samples[i] = mix / this->channels;
+        }
+    }
+};
+
+//============================================================================
+// MODULES
+//============================================================================
+
+// creates the module described by spec and appends the names of its features,
+// returns NULL if spec is invalid
+static AnalysisModule* createModule(const std::string& spec, int sampleRate, std::vector<std::string>& names)
+{
+    std::string name  = spec.substr(0, spec.find('='));
+    std::string param = spec.find('=') == std::string::npos ? "" : spec.substr(spec.find('=') + 1);
+    int         count = param.empty() ? 0 : atoi(param.c_str());
+
+    if (name == "total") {
+        names.push_back(name);
+        return new TotalAmplitude();
+    } else if (name == "max") {
+        names.push_back(name);
+        return new MaxAmplitude();
+    } else if (name == "mean") {
+        names.push_back(name);
+        return new MeanAmplitude();
+    } else if (name == "centroid") {
+        names.push_back(name);
+        return new Centroid();
+    } else if (name == "noisiness") {
+        names.push_back(name);
+        return new Noisiness();
+    } else if (name == "percussion") {
+        names.push_back(name);
+        return new PercussionDetection();
+    } else if (name == "formants") {
+        names.push_back(name);
+        return new Formants();
+    } else if (name == "deltas") {
+        for (int i = 0; i < NUM_BINS; i++) {
+            names.push_back("delta" + std::to_string(i));
+        }
+        return new DeltaAmplitudes();
+    } else if (name == "peaks") {
+        int numPeaks = param.empty() ? 4 : count;
+        if (numPeaks < 1) {
+            return NULL;
+        }
+        for (int i = 0; i < numPeaks; i++) {
+            names.push_back("peak_freq" + std::to_string(i));
+        }
+        for (int i = 0; i < numPeaks; i++) {
+            names.push_back("peak_amp" + std::to_string(i));
+        }
+        return new MajorPeaks(numPeaks);
+    } else if (name == "salient") {
+        int numFreqs = param.empty() ? 3 : count;
+        if (numFreqs < 1) {
+            return NULL;
+        }
+        for (int i = 0; i < numFreqs; i++) {
+            names.push_back("salient" + std::to_string(i));
+        }
+        return new SalientFreqs(numFreqs);
+    } else if (name == "mfcc") {
+        int numCoeffs = param.empty() ? 13 : count;
+        if (numCoeffs < 1 || numCoeffs > 40) {
+            return NULL;
+        }
+        for (int i = 0; i < numCoeffs; i++) {
+            names.push_back("mfcc" + std::to_string(i));
+        }
+        // the mel bands span the spectrum at the file's sample rate
+        MFCC* mfcc = new MFCC(numCoeffs);
+        mfcc->setSampleRate(sampleRate);
+        mfcc->setFrequencyRange(0, sampleRate >> 1);
+        return mfcc;
+    } else if (name == "bands") {
+        std::vector<int> edges;
+        for (size_t start = 0; start < param.size();) {
+            size_t end = param.find(':', start);
+            if (end == std::string::npos) {
+                end = param.size();
+            }
+            edges.push_back(atoi(param.substr(start, end - start).c_str()));
+            start = end + 1;
+        }
+        if (edges.size() < 2) {
+            return NULL;
+        }
+
+        for (size_t i = 0; i + 1 < edges.size(); i++) {
+            names.push_back("band" + std::to_string(edges[i]) + "_" + std::to_string(edges[i + 1]));
+        }
+        // band edges are converted to bins at the file's sample rate
+        BreadSlicer* slicer = new BreadSlicer();
+        slicer->setSampleRate(sampleRate);
+        slicer->setBands(edges.data(), edges.size() - 1);
+        return slicer;
+    }
+    return NULL;
+}
+
+//============================================================================
+// OUTPUT
+//============================================================================
+
+// writes the first numFrames rows of a block's feature matrix
+static void writeBlock(FILE* out, bool binary, const float* features, int numFeatures,
+    int numFrames, uint64_t firstFrame, double secondsPerFrame, std::vector<float>& row)
+{
+    for (int f = 0; f < numFrames; f++) {
+        for (int i = 0; i < numFeatures; i++) {
+            row[i] = features[i * BLOCK_FRAMES + f];
+        }
+
+        if (binary) {
+            fwrite(row.data(), sizeof(float), numFeatures, out);
+            continue;
+        }
+        fprintf(out, "%.6f", (firstFrame + f) * secondsPerFrame);
+        for (int i = 0; i < numFeatures; i++) {
+            fprintf(out, ",%g", row[i]);
+        }
+        fputc('\n', out);
+    }
+}
+
+static void printUsage(const char* program)
+{
+    fprintf(stderr,
+        "Usage: %s [-m SPEC]... [-o FILE] [-f csv|bin] [--hop N] [--raw]\n"
+        "          [--rate N] [--channels N] [--pcm s16|s32|f32] [-q] INPUT\n"
+        "Modules: total, max, mean, centroid, noisiness, percussion, formants,\n"
+        "         deltas, peaks[=N], salient[=N], mfcc[=N], bands=F0:F1:...:FN\n",
+        program);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> specs;
+    const char*              inputPath   = NULL;
+    const char*              outputPath  = NULL;
+    bool                     binary      = false;
+    bool                     raw         = false;
+    bool                     quiet       = false;
+    int                      rawRate     = SAMPLE_RATE;
+    int                      rawChannels = 1;
+    int                      hopSize     = WINDOW_SIZE;
+    SampleType               rawType     = SAMPLE_S16;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg     = argv[i];
+        bool        hasNext = i + 1 < argc;
+        if ((strcmp(arg, "-m") == 0 || strcmp(arg, "--module") == 0) && hasNext) {
+            specs.push_back(argv[++i]);
+        } else if ((strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) && hasNext) {
+            outputPath = argv[++i];
+        } else if ((strcmp(arg, "-f") == 0 || strcmp(arg, "--format") == 0) && hasNext) {
+            const char* format = argv[++i];
+            if (strcmp(format, "bin") != 0 && strcmp(format, "csv") != 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            binary = strcmp(format, "bin") == 0;
+        } else if (strcmp(arg, "--hop") == 0 && hasNext) {
+            hopSize = atoi(argv[++i]);
+        } else if (strcmp(arg, "--raw") == 0) {
+            raw = true;
+        } else if (strcmp(arg, "--rate") == 0 && hasNext) {
+            rawRate = atoi(argv[++i]);
+        } else if (strcmp(arg, "--channels") == 0 && hasNext) {
+            rawChannels = atoi(argv[++i]);
+        } else if (strcmp(arg, "--pcm") == 0 && hasNext) {
+            const char* type = argv[++i];
+            if (strcmp(type, "s16") == 0) {
+                rawType = SAMPLE_S16;
+            } else if (strcmp(type, "s32") == 0) {
+                rawType = SAMPLE_S32;
+            } else if (strcmp(type, "f32") == 0) {
+                rawType = SAMPLE_F32;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(arg, "-q") == 0 || strcmp(arg, "--quiet") == 0) {
+            quiet = true;
+        } else if (inputPath == NULL && (arg[0] != '-' || strcmp(arg, "-") == 0)) {
+            inputPath = arg;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (inputPath == NULL || rawRate <= 0 || rawChannels < 1 || rawChannels > 8
+        || hopSize < 1 || hopSize > WINDOW_SIZE) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (specs.empty()) {
+        specs.push_back("total");
+        specs.push_back("centroid");
+        specs.push_back("noisiness");
+        specs.push_back("peaks=4");
+    }
+
+    PcmReader reader;
+    if (!reader.open(inputPath)) {
+        return 1;
+    }
+    if (raw) {
+        reader.setRawFormat(rawRate, rawChannels, rawType);
+    } else if (!reader.readWavHeader()) {
+        return 1;
+    }
+    int sampleRate = reader.getSampleRate();
+
+    // module errors are reported through Serial
+    Serial.setSink(stderr);
+
+    // the spectrogram reaches back to the last window that does not overlap
+    // the current one
+    Spectrogram spectrogram = Spectrogram((WINDOW_SIZE + hopSize - 1) / hopSize + 1);
+    spectrogram.setHopSize(hopSize);
+    ModuleGroup group       = ModuleGroup(&spectrogram, 0, sampleRate >> 1);
+
+    std::vector<AnalysisModule*> modules;
+    std::vector<std::string>     names;
+    for (const std::string& spec : specs) {
+        AnalysisModule* module = createModule(spec, sampleRate, names);
+        if (module == NULL) {
+            fprintf(stderr, "Error: invalid module '%s'\n", spec.c_str());
+            return 1;
+        }
+        if (sampleRate != SAMPLE_RATE) {
+            module->setSampleRate(sampleRate);
+        }
+        group.addModule(module);
+        modules.push_back(module);
+    }
+
+    int numFeatures = group.getNumFeatures();
+    if (numFeatures != int(names.size())) {
+        fprintf(stderr, "Error: invalid module parameters\n");
+        return 1;
+    }
+
+    FILE* out = outputPath == NULL ? stdout : fopen(outputPath, binary ? "wb" : "w");
+    if (out == NULL) {
+        fprintf(stderr, "Error: could not open %s\n", outputPath);
+        return 1;
+    }
+    if (!binary) {
+        fprintf(out, "time");
+        for (const std::string& name : names) {
+            fprintf(out, ",%s", name.c_str());
+        }
+        fputc('\n', out);
+    }
+
+    STFT stft = STFT(hopSize, WINDOW_HAMMING);
+
+    std::vector<float> samples(WINDOW_SIZE);
+    std::vector<float> frames(BLOCK_FRAMES * NUM_BINS);
+    std::vector<float> features(BLOCK_FRAMES * numFeatures);
+    std::vector<float> row(numFeatures);
+
+    double   secondsPerFrame = double(hopSize) / sampleRate;
+    uint64_t numSamples      = 0;
+    uint64_t numFrames       = 0;
+    int      blockFrames     = 0;
+
+    // every window starting before the end of the input is analyzed
+    uint64_t maxFrames = UINT64_MAX;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while (maxFrames == UINT64_MAX) {
+        int read = reader.read(samples.data(), WINDOW_SIZE);
+        numSamples += read;
+
+        // at the end of the input, the windows over the last samples are
+        // completed with a window of silence
+        int numChunks = 1;
+        if (read < WINDOW_SIZE) {
+            for (int i = read; i < WINDOW_SIZE; i++) {
+                samples[i] = 0;
+            }
+            maxFrames = (numSamples + hopSize - 1) / hopSize;
+            numChunks = 2;
+        }
+
+        for (int chunk = 0; chunk < numChunks; chunk++) {
+            if (chunk == 1) {
+                for (int i = 0; i < WINDOW_SIZE; i++) {
+                    samples[i] = 0;
+                }
+            }
+            stft.addSamples(samples.data(), WINDOW_SIZE);
+
+            while (numFrames + blockFrames < maxFrames
+                && stft.nextFrame(&frames[blockFrames * NUM_BINS])) {
+                blockFrames++;
+                if (blockFrames == BLOCK_FRAMES) {
+                    group.analyzeBatch(frames.data(), blockFrames, features.data(), BLOCK_FRAMES);
+                    writeBlock(out, binary, features.data(), numFeatures, blockFrames, numFrames, secondsPerFrame, row);
+                    numFrames += blockFrames;
+                    blockFrames = 0;
+                }
+            }
+        }
+    }
+    if (blockFrames > 0) {
+        group.analyzeBatch(frames.data(), blockFrames, features.data(), BLOCK_FRAMES);
+        writeBlock(out, binary, features.data(), numFeatures, blockFrames, numFrames, secondsPerFrame, row);
+        numFrames += blockFrames;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    if (!quiet) {
+        double audioSeconds = double(numSamples) / sampleRate;
+        fprintf(stderr, "%llu frames (%.1f s of audio) in %.3f s: %.0f frames/s, %.1fx real time\n",
+            (unsigned long long)numFrames, audioSeconds, elapsed,
+            elapsed > 0 ? numFrames / elapsed : 0.0, elapsed > 0 ? audioSeconds / elapsed : 0.0);
+    }
+
+    for (AnalysisModule* module : modules) {
+        delete module;
+    }
+    return 0;
+}